@@ -0,0 +1,2 @@
+set(bench_source
+    bench/benchmarks.cpp)
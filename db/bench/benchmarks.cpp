@@ -0,0 +1,322 @@
+//Benchmarks of the VIN and RegMark hot paths.
+//Every benchmark runs over a generated corpus of 4096 items and reports items/sec
+//and the number of heap allocations per call (allocs_per_call).
+//Set VIN_CORPUS_DIR to keep the corpora on disk and reuse them between runs.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "corpus.hpp"
+#include "plate_inventory.hpp"
+#include "reg_mark.hpp"
+#include "vin.hpp"
+#include "vin_cache.hpp"
+
+// Every replaceable form of operator new is counted, the deletes match them, so the scalar, array,
+// aligned and nothrow forms all go through allocate and release
+namespace {
+    std::atomic<std::size_t> allocations{0};
+
+    [[nodiscard]] void *allocate(std::size_t size, std::size_t alignment) noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if (size == 0)
+            size = 1;
+        if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return std::malloc(size);
+        // aligned_alloc needs the size to be a multiple of the alignment
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+    [[nodiscard]] void *allocateOrThrow(std::size_t size, std::size_t alignment)
+    {
+        if (void *pointer = allocate(size, alignment))
+            return pointer;
+        throw std::bad_alloc();
+    }
+    void release(void *pointer) noexcept
+    {
+        std::free(pointer);
+    }
+}
+
+void *operator new(std::size_t size) { return allocateOrThrow(size, 0); }
+void *operator new[](std::size_t size) { return allocateOrThrow(size, 0); }
+void *operator new(std::size_t size, std::align_val_t alignment) { return allocateOrThrow(size, static_cast<std::size_t>(alignment)); }
+void *operator new[](std::size_t size, std::align_val_t alignment) { return allocateOrThrow(size, static_cast<std::size_t>(alignment)); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return allocate(size, 0); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return allocate(size, 0); }
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *pointer) noexcept { release(pointer); }
+void operator delete[](void *pointer) noexcept { release(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { release(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { release(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void *pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { release(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { release(pointer); }
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept { release(pointer); }
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept { release(pointer); }
+
+namespace {
+    const std::size_t corpus_size = 4096;
+    const char *corpus_directory_variable = "VIN_CORPUS_DIR";
+
+    enum VINCorpus {
+        VALID,
+        INVALID_CHECKSUM,
+        ILLEGAL_SYMBOLS,
+        RARE_WMI
+    };
+    const std::array<const char *, 4> corpus_names = {"valid", "invalid_checksum", "illegal_symbols", "rare_wmi"};
+
+    // Throws output away, but still lets the streams do their work
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int symbol) override { return symbol; }
+    };
+
+    // If VIN_CORPUS_DIR is set, the corpus is read from <dir>/<name>.txt,
+    // a missing file is generated and written there for the next runs
+    template <typename Generate>
+    [[nodiscard]] std::vector<std::string> loadCorpus(const std::string &name, Generate generate)
+    {
+        const char *directory = std::getenv(corpus_directory_variable);
+        std::vector<std::string> corpus;
+        if (directory == nullptr)
+            return generate();
+        const std::string path = std::string(directory) + "/" + name + ".txt";
+        if (Corpus::readCorpus(path, corpus) && !corpus.empty())
+            return corpus;
+        corpus = generate();
+        if (!Corpus::writeCorpus(path, corpus))
+            std::cout << "Can't write corpus " << path << '\n';
+        return corpus;
+    }
+
+    [[nodiscard]] std::vector<std::string> makeVINCorpus(VINCorpus kind)
+    {
+        const std::array<Corpus::VINKind, 4> kinds = {Corpus::VINKind::VALID, Corpus::VINKind::INVALID_CHECKSUM,
+                                                      Corpus::VINKind::ILLEGAL_SYMBOLS, Corpus::VINKind::RARE_WMI};
+        return loadCorpus(std::string("vin_") + corpus_names[kind], [&] {
+            return Corpus::Generator(kind + 1).MakeVINs(kinds[kind], corpus_size);
+        });
+    }
+
+    [[nodiscard]] std::vector<std::string> makeMarkCorpus(bool valid)
+    {
+        return loadCorpus(valid ? "mark_valid" : "mark_illegal_symbols", [&] {
+            return Corpus::Generator(valid ? 10 : 11).MakeMarks(valid ? Corpus::MarkKind::VALID : Corpus::MarkKind::ILLEGAL_SYMBOLS,
+                                                                corpus_size);
+        });
+    }
+
+    const std::array<std::vector<std::string>, 4> &getVINCorpora()
+    {
+        static const std::array<std::vector<std::string>, 4> corpora = {
+            makeVINCorpus(VALID), makeVINCorpus(INVALID_CHECKSUM), makeVINCorpus(ILLEGAL_SYMBOLS), makeVINCorpus(RARE_WMI)
+        };
+        return corpora;
+    }
+
+    const std::vector<std::string> &getMarkCorpus(bool valid)
+    {
+        static const std::vector<std::string> valid_corpus = makeMarkCorpus(true);
+        static const std::vector<std::string> invalid_corpus = makeMarkCorpus(false);
+        return valid ? valid_corpus : invalid_corpus;
+    }
+
+    // Runs function over the corpus and sets items/sec and allocations per call
+    template <typename Function>
+    void runOverCorpus(benchmark::State &state, const std::vector<std::string> &corpus, Function function)
+    {
+        std::size_t index = 0;
+        const std::size_t allocations_before = allocations.load(std::memory_order_relaxed);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(function(corpus[index]));
+            index = (index + 1) % corpus.size();
+        }
+        const std::size_t allocations_after = allocations.load(std::memory_order_relaxed);
+        state.SetItemsProcessed(state.iterations());
+        state.counters["allocs_per_call"] = benchmark::Counter(static_cast<double>(allocations_after - allocations_before),
+                                                               benchmark::Counter::kAvgIterations);
+    }
+
+    void vinCorpusArguments(benchmark::internal::Benchmark *benchmark)
+    {
+        benchmark->ArgName("corpus");
+        for (std::size_t i = 0; i < corpus_names.size(); ++i)
+            benchmark->Arg(static_cast<int>(i));
+    }
+}
+
+static void BM_checkVIN(benchmark::State &state)
+{
+    runOverCorpus(state, getVINCorpora()[state.range(0)], [](const std::string &vin) { return VIN::checkVIN(vin); });
+    state.SetLabel(corpus_names[state.range(0)]);
+}
+BENCHMARK(BM_checkVIN)->Apply(vinCorpusArguments);
+
+static void BM_validateVIN(benchmark::State &state)
+{
+    runOverCorpus(state, getVINCorpora()[state.range(0)], [](const std::string &vin) { return VIN::validateVIN(vin); });
+    state.SetLabel(corpus_names[state.range(0)]);
+}
+BENCHMARK(BM_validateVIN)->Apply(vinCorpusArguments);
+
+static void BM_getVINCountry(benchmark::State &state)
+{
+    runOverCorpus(state, getVINCorpora()[state.range(0)], [](const std::string &vin) { return VIN::getVINCountry(vin); });
+    state.SetLabel(corpus_names[state.range(0)]);
+}
+BENCHMARK(BM_getVINCountry)->Arg(VALID)->Arg(RARE_WMI)->ArgName("corpus");
+
+static void BM_getVINCountryId(benchmark::State &state)
+{
+    runOverCorpus(state, getVINCorpora()[state.range(0)], [](const std::string &vin) { return VIN::getVINCountryId(vin); });
+    state.SetLabel(corpus_names[state.range(0)]);
+}
+BENCHMARK(BM_getVINCountryId)->Arg(VALID)->Arg(RARE_WMI)->ArgName("corpus");
+
+static void BM_getTransportYear(benchmark::State &state)
+{
+    runOverCorpus(state, getVINCorpora()[VALID], [](const std::string &vin) { return VIN::getTransportYear(vin); });
+}
+BENCHMARK(BM_getTransportYear);
+
+static void BM_decode(benchmark::State &state)
+{
+    runOverCorpus(state, getVINCorpora()[state.range(0)], [](const std::string &vin) { return VIN::decode(vin); });
+    state.SetLabel(corpus_names[state.range(0)]);
+}
+BENCHMARK(BM_decode)->Apply(vinCorpusArguments);
+
+// Feed that repeats the same vehicles, a hot set smaller than the cache is decoded only once
+static void BM_DecodeCache(benchmark::State &state)
+{
+    const std::vector<std::string> &corpus = getVINCorpora()[VALID];
+    const std::vector<std::string> vehicles(corpus.begin(), corpus.begin() + std::min<std::size_t>(state.range(0), corpus.size()));
+    VIN::DecodeCache cache;
+    runOverCorpus(state, vehicles, [&cache](const std::string &vin) { return cache.Decode(vin); });
+    const VIN::DecodeCache::Stats stats = cache.GetStats();
+    state.counters["hit_rate"] = static_cast<double>(stats.hits) / static_cast<double>(stats.hits + stats.misses);
+}
+BENCHMARK(BM_DecodeCache)->Arg(1 << 10)->Arg(1 << 20)->ArgName("vehicles");
+
+// Corrections of the OCR stream: the check digit fails, candidates are pruned by the checksum weights
+static void BM_findCorrections(benchmark::State &state)
+{
+    runOverCorpus(state, getVINCorpora()[state.range(0)], [](const std::string &vin) { return VIN::findCorrections(vin).count; });
+    state.SetLabel(corpus_names[state.range(0)]);
+}
+BENCHMARK(BM_findCorrections)->Arg(INVALID_CHECKSUM)->Arg(ILLEGAL_SYMBOLS)->ArgName("corpus");
+
+static void BM_normalizeVIN(benchmark::State &state)
+{
+    runOverCorpus(state, getVINCorpora()[VALID], [](const std::string &vin) {
+        char scanned[24];
+        vin.copy(scanned, vin.size());
+        return VIN::normalizeVIN(scanned, vin.size());
+    });
+}
+BENCHMARK(BM_normalizeVIN);
+
+// Whole corpus per iteration, items are VINs
+static void BM_checkVINBatch(benchmark::State &state)
+{
+    std::string records;
+    for (const auto &vin : getVINCorpora()[state.range(0)])
+        records += vin;
+    const std::size_t count = records.size() / 17;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(VIN::checkVINBatch(records.data(), count));
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetLabel(corpus_names[state.range(0)]);
+}
+BENCHMARK(BM_checkVINBatch)->Arg(VALID)->Arg(INVALID_CHECKSUM)->ArgName("corpus");
+
+static void BM_CheckMark(benchmark::State &state)
+{
+    runOverCorpus(state, getMarkCorpus(state.range(0)), [](const std::string &mark) { return RegMark::CheckMark(mark); });
+    state.SetLabel(state.range(0) ? "valid" : "illegal_symbols");
+}
+BENCHMARK(BM_CheckMark)->Arg(1)->Arg(0)->ArgName("valid");
+
+static void BM_GetNextMarkAfter(benchmark::State &state)
+{
+    runOverCorpus(state, getMarkCorpus(true), [](const std::string &mark) { return RegMark::GetNextMarkAfter(mark); });
+}
+BENCHMARK(BM_GetNextMarkAfter);
+
+static void BM_GetNextMarkAfterRange(benchmark::State &state)
+{
+    const std::string range_start = "A001AA770";
+    const std::string range_end = "Y999YY770";
+    runOverCorpus(state, getMarkCorpus(true), [&](const std::string &mark) {
+        return RegMark::GetNextMarkAfterRange(mark, range_start, range_end);
+    });
+}
+BENCHMARK(BM_GetNextMarkAfterRange);
+
+static void BM_MarkNext(benchmark::State &state)
+{
+    RegMark::Mark mark = *RegMark::Mark::Parse("A001AA770");
+    const std::size_t allocations_before = allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        mark = mark.Next();
+        benchmark::DoNotOptimize(mark);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_call"] = benchmark::Counter(
+        static_cast<double>(allocations.load(std::memory_order_relaxed) - allocations_before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_MarkNext);
+
+// Every mark of the region but the last one is issued, so the search crosses the whole region
+static void BM_PlateInventoryIssueNext(benchmark::State &state)
+{
+    const RegMark::Mark first = *RegMark::Mark::Parse("A001AA770");
+    const RegMark::Mark last = *RegMark::Mark::Parse("Y999YY770");
+    RegMark::PlateInventory inventory;
+    for (RegMark::Mark mark = first; mark != last; mark = mark.Next())
+        inventory.Issue(mark);
+    const std::size_t allocations_before = allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        const std::optional<RegMark::Mark> mark = inventory.IssueNext(first, first, last);
+        benchmark::DoNotOptimize(mark);
+        inventory.Release(*mark);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_call"] = benchmark::Counter(
+        static_cast<double>(allocations.load(std::memory_order_relaxed) - allocations_before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_PlateInventoryIssueNext);
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    // Error messages of checkVIN/CheckMark go to std::cerr, the report goes to std::cout
+    NullBuffer null_buffer;
+    std::streambuf *error_buffer = std::cerr.rdbuf(&null_buffer);
+    benchmark::RunSpecifiedBenchmarks();
+    std::cerr.rdbuf(error_buffer);
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,278 @@
+//Sorted VIN and license plate indexes with the parallel bulk build
+#include "index.hpp"
+#include <algorithm>
+#include <future>
+#include <tuple>
+
+using string = std::string;
+using size_t = std::size_t;
+using uint8_t = std::uint8_t;
+using uint16_t = std::uint16_t;
+using uint32_t = std::uint32_t;
+using uint64_t = std::uint64_t;
+
+namespace Index {
+    const size_t vin_size = 17;
+    //  Records of the source vector handled by one task
+    const size_t records_per_part = 1 << 16;
+    //  Smaller arrays are sorted by the calling thread
+    const size_t min_parallel_sort = 1 << 15;
+
+    [[nodiscard]] VINEntry makeVINEntry(const char *vin, uint64_t row, uint16_t model_year) noexcept;
+    [[nodiscard]] VINEntry makeVINKey(std::string_view prefix, uint8_t fill) noexcept;
+    [[nodiscard]] inline uint64_t makeYearKey(const VINEntry &entry, uint16_t model_year) noexcept;
+    [[nodiscard]] inline bool isKeyLess(const VINEntry &first, const VINEntry &second) noexcept;
+    [[nodiscard]] inline bool isVINEntryLess(const VINEntry &first, const VINEntry &second) noexcept;
+    [[nodiscard]] inline bool isMarkEntryLess(const MarkEntry &first, const MarkEntry &second) noexcept;
+
+    //  Runs fill(part) for every part on the pool and concatenates the results in the order of parts
+    template <typename Entry, typename Fill>
+    [[nodiscard]] std::vector<Entry> collectEntries(size_t parts, Batch::ThreadPool &pool, const Fill &fill)
+    {
+        std::vector<std::future<std::vector<Entry>>> futures;
+        futures.reserve(parts);
+        for (size_t part = 0; part < parts; ++part)
+            futures.push_back(pool.Submit([&fill, part] { return fill(part); }));
+        std::vector<std::vector<Entry>> results;
+        results.reserve(parts);
+        size_t total = 0;
+        for (auto &future : futures) {
+            results.push_back(future.get());
+            total += results.back().size();
+        }
+        std::vector<Entry> entries;
+        entries.reserve(total);
+        for (const auto &result : results)
+            entries.insert(entries.end(), result.begin(), result.end());
+        return entries;
+    }
+
+    //  Every worker sorts its own slice, then neighbouring slices are merged pairwise in log2(workers) rounds
+    template <typename Entry, typename Less>
+    void parallelSort(std::vector<Entry> &entries, Batch::ThreadPool &pool, Less less)
+    {
+        const size_t parts = std::min(pool.Size(), entries.size() / min_parallel_sort);
+        if (parts < 2) {
+            std::sort(entries.begin(), entries.end(), less);
+            return;
+        }
+        std::vector<size_t> bounds(parts + 1);
+        for (size_t part = 0; part <= parts; ++part)
+            bounds[part] = entries.size() * part / parts;
+
+        const auto begin = entries.begin();
+        std::vector<std::future<void>> futures;
+        for (size_t part = 0; part < parts; ++part)
+            futures.push_back(pool.Submit([&, part] { std::sort(begin + bounds[part], begin + bounds[part + 1], less); }));
+        for (auto &future : futures)
+            future.get();
+
+        for (size_t width = 1; width < parts; width *= 2) {
+            futures.clear();
+            for (size_t part = 0; part + width < parts; part += 2 * width) {
+                const size_t middle = bounds[part + width];
+                const size_t end = bounds[std::min(part + 2 * width, parts)];
+                futures.push_back(pool.Submit([&, part, middle, end] {
+                    std::inplace_merge(begin + bounds[part], begin + middle, begin + end, less);
+                }));
+            }
+            for (auto &future : futures)
+                future.get();
+        }
+    }
+}
+
+[[nodiscard]] Index::VINEntry Index::makeVINEntry(const char *vin, uint64_t row, uint16_t model_year) noexcept
+{
+    VINEntry entry = {};
+    for (size_t i = 0; i < 8; ++i) {
+        entry.high = entry.high << 8 | static_cast<uint8_t>(vin[i]);
+        entry.low = entry.low << 8 | static_cast<uint8_t>(vin[i + 8]);
+    }
+    entry.last = static_cast<uint8_t>(vin[16]);
+    entry.row = row;
+    entry.model_year = model_year;
+    return entry;
+}
+
+// Symbols after the prefix are filled with the smallest or the largest byte
+[[nodiscard]] Index::VINEntry Index::makeVINKey(std::string_view prefix, uint8_t fill) noexcept
+{
+    char vin[vin_size];
+    std::fill(vin, vin + vin_size, static_cast<char>(fill));
+    std::copy_n(prefix.data(), std::min(prefix.size(), vin_size), vin);
+    return makeVINEntry(vin, 0, 0);
+}
+
+// WMI is the three most significant bytes of high
+[[nodiscard]] inline uint64_t Index::makeYearKey(const VINEntry &entry, uint16_t model_year) noexcept
+{
+    return (entry.high >> 40) << 16 | model_year;
+}
+
+[[nodiscard]] inline bool Index::isKeyLess(const VINEntry &first, const VINEntry &second) noexcept
+{
+    return std::tie(first.high, first.low, first.last) < std::tie(second.high, second.low, second.last);
+}
+
+// Equal VIN numbers are ordered by row, so the index doesn't depend on the thread count
+[[nodiscard]] inline bool Index::isVINEntryLess(const VINEntry &first, const VINEntry &second) noexcept
+{
+    return std::tie(first.high, first.low, first.last, first.row) < std::tie(second.high, second.low, second.last, second.row);
+}
+
+[[nodiscard]] inline bool Index::isMarkEntryLess(const MarkEntry &first, const MarkEntry &second) noexcept
+{
+    return first.mark < second.mark || (first.mark == second.mark && first.row < second.row);
+}
+
+void Index::VINEntry::FormatTo(char *out) const noexcept
+{
+    for (size_t i = 0; i < 8; ++i) {
+        out[i] = static_cast<char>(high >> (56 - 8 * i));
+        out[i + 8] = static_cast<char>(low >> (56 - 8 * i));
+    }
+    out[16] = static_cast<char>(last);
+}
+
+[[nodiscard]] string Index::VINEntry::Format() const
+{
+    string vin(vin_size, ' ');
+    FormatTo(vin.data());
+    return vin;
+}
+
+[[nodiscard]] Index::VINIndex Index::VINIndex::Build(const Registry::Reader &registry, Batch::ThreadPool &pool)
+{
+    if (registry.Kind() != Registry::RecordKind::VIN)
+        return VINIndex();
+    std::vector<VINEntry> entries = collectEntries<VINEntry>(registry.GroupCount(), pool, [&registry](size_t index) {
+        const Registry::ColumnGroup group = registry.Group(index);
+        const uint64_t first_row = static_cast<uint64_t>(index) * registry.RowsPerGroup();
+        std::vector<VINEntry> result;
+        for (size_t row = 0; row < group.rows; ++row) {
+            if (group.errors[row] == 0)
+                result.push_back(makeVINEntry(group.vins + row * vin_size, first_row + row, group.model_years[row]));
+        }
+        return result;
+    });
+    parallelSort(entries, pool, isVINEntryLess);
+    return VINIndex(std::move(entries), pool);
+}
+
+[[nodiscard]] Index::VINIndex Index::VINIndex::Build(const std::vector<string> &vins, Batch::ThreadPool &pool)
+{
+    const size_t parts = (vins.size() + records_per_part - 1) / records_per_part;
+    std::vector<VINEntry> entries = collectEntries<VINEntry>(parts, pool, [&vins](size_t part) {
+        const size_t end = std::min(vins.size(), (part + 1) * records_per_part);
+        std::vector<VINEntry> result;
+        for (size_t row = part * records_per_part; row < end; ++row) {
+            const VIN::DecodedVIN decoded = VIN::decode(vins[row]);
+            if (decoded.valid())
+                result.push_back(makeVINEntry(vins[row].data(), row, decoded.model_year));
+        }
+        return result;
+    });
+    parallelSort(entries, pool, isVINEntryLess);
+    return VINIndex(std::move(entries), pool);
+}
+
+// Entries are already sorted, so the position breaks the ties of the key in the VIN order
+Index::VINIndex::VINIndex(std::vector<VINEntry> sorted_entries, Batch::ThreadPool &pool)
+    : entries(std::move(sorted_entries)), year_keys(entries.size())
+{
+    for (size_t i = 0; i < entries.size(); ++i)
+        year_keys[i] = {makeYearKey(entries[i], entries[i].model_year), i};
+    parallelSort(year_keys, pool, [](const YearKey &first, const YearKey &second) {
+        return std::tie(first.key, first.position) < std::tie(second.key, second.position);
+    });
+}
+
+[[nodiscard]] Index::Range<Index::VINEntry> Index::VINIndex::Find(std::string_view vin) const noexcept
+{
+    if (vin.size() != vin_size)
+        return {};
+    return FindPrefix(vin);
+}
+
+[[nodiscard]] Index::Range<Index::VINEntry> Index::VINIndex::FindPrefix(std::string_view prefix) const noexcept
+{
+    if (prefix.size() > vin_size)
+        return {};
+    const auto first = std::lower_bound(entries.begin(), entries.end(), makeVINKey(prefix, 0), isKeyLess);
+    const auto last = std::upper_bound(first, entries.end(), makeVINKey(prefix, UINT8_MAX), isKeyLess);
+    return {entries.data() + (first - entries.begin()), entries.data() + (last - entries.begin())};
+}
+
+[[nodiscard]] std::vector<uint64_t> Index::VINIndex::FindByWMIAndYear(std::string_view wmi, uint16_t model_year) const
+{
+    std::vector<uint64_t> rows;
+    if (wmi.size() != 3)
+        return rows;
+    const YearKey key = {makeYearKey(makeVINKey(wmi, 0), model_year), 0};
+    const auto [first, last] = std::equal_range(year_keys.begin(), year_keys.end(), key, [](const YearKey &left, const YearKey &right) {
+        return left.key < right.key;
+    });
+    rows.reserve(static_cast<size_t>(last - first));
+    for (auto it = first; it != last; ++it)
+        rows.push_back(entries[it->position].row);
+    return rows;
+}
+
+[[nodiscard]] Index::MarkIndex Index::MarkIndex::Build(const Registry::Reader &registry, Batch::ThreadPool &pool)
+{
+    if (registry.Kind() != Registry::RecordKind::MARK)
+        return MarkIndex();
+    std::vector<MarkEntry> entries = collectEntries<MarkEntry>(registry.GroupCount(), pool, [&registry](size_t index) {
+        const Registry::ColumnGroup group = registry.Group(index);
+        const uint64_t first_row = static_cast<uint64_t>(index) * registry.RowsPerGroup();
+        std::vector<MarkEntry> result;
+        for (size_t row = 0; row < group.rows; ++row) {
+            if (group.errors[row] == 0)
+                result.push_back({RegMark::Mark::FromValue(group.marks[row]), first_row + row});
+        }
+        return result;
+    });
+    parallelSort(entries, pool, isMarkEntryLess);
+    return MarkIndex(std::move(entries));
+}
+
+[[nodiscard]] Index::MarkIndex Index::MarkIndex::Build(const std::vector<string> &marks, Batch::ThreadPool &pool)
+{
+    const size_t parts = (marks.size() + records_per_part - 1) / records_per_part;
+    std::vector<MarkEntry> entries = collectEntries<MarkEntry>(parts, pool, [&marks](size_t part) {
+        const size_t end = std::min(marks.size(), (part + 1) * records_per_part);
+        std::vector<MarkEntry> result;
+        for (size_t row = part * records_per_part; row < end; ++row) {
+            if (const std::optional<RegMark::Mark> mark = RegMark::Mark::Parse(marks[row]))
+                result.push_back({*mark, row});
+        }
+        return result;
+    });
+    parallelSort(entries, pool, isMarkEntryLess);
+    return MarkIndex(std::move(entries));
+}
+
+[[nodiscard]] Index::Range<Index::MarkEntry> Index::MarkIndex::Find(RegMark::Mark mark) const noexcept
+{
+    return FindRange(mark, mark);
+}
+
+[[nodiscard]] Index::Range<Index::MarkEntry> Index::MarkIndex::FindRange(RegMark::Mark first, RegMark::Mark last) const noexcept
+{
+    if (last < first)
+        return {};
+    const auto begin = std::lower_bound(entries.begin(), entries.end(), first,
+                                        [](const MarkEntry &entry, RegMark::Mark mark) { return entry.mark < mark; });
+    const auto end = std::upper_bound(begin, entries.end(), last,
+                                      [](RegMark::Mark mark, const MarkEntry &entry) { return mark < entry.mark; });
+    return {entries.data() + (begin - entries.begin()), entries.data() + (end - entries.begin())};
+}
+
+[[nodiscard]] Index::Range<Index::MarkEntry> Index::MarkIndex::FindSeriesRange(uint32_t region, uint32_t first_series, uint32_t last_series) const noexcept
+{
+    using RegMark::Mark;
+    if (region > Mark::max_region || first_series > last_series || last_series >= Mark::series_count)
+        return {};
+    return FindRange(Mark::FromParts(region, first_series, 1), Mark::FromParts(region, last_series, Mark::max_number));
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "reg_mark.hpp"
+#include "registry.hpp"
+#include "thread_pool.hpp"
+
+//  In-memory sorted indexes over valid VIN numbers and license plate numbers.
+//  Entries are kept in one sorted array, every query is a pair of binary searches and
+//  returns a contiguous range of entries. Row is the registry row (or the position in the
+//  source vector) of the record.
+namespace Index {
+    //  Contiguous range of sorted entries
+    template <typename Entry>
+    struct Range {
+        const Entry *first = nullptr;
+        const Entry *last = nullptr;
+
+        [[nodiscard]] const Entry *begin() const noexcept { return first; }
+        [[nodiscard]] const Entry *end() const noexcept { return last; }
+        [[nodiscard]] std::size_t size() const noexcept { return static_cast<std::size_t>(last - first); }
+        [[nodiscard]] bool empty() const noexcept { return first == last; }
+    };
+
+    //  VIN packed into big-endian integers, so integer order is the lexicographic order of the symbols
+    struct VINEntry {
+        std::uint64_t high;         // symbols 0-7, the first symbol is the most significant byte
+        std::uint64_t low;          // symbols 8-15
+        std::uint64_t row;
+        std::uint8_t last;          // symbol 16
+        std::uint16_t model_year;
+
+        //  Writes 17 symbols of the VIN without allocations
+        void FormatTo(char *out) const noexcept;
+        [[nodiscard]] std::string Format() const;
+    };
+
+    struct MarkEntry {
+        RegMark::Mark mark;
+        std::uint64_t row;
+    };
+
+    class VINIndex {
+    public:
+        VINIndex() = default;
+        //  Indexes the valid rows of a VIN registry, row groups are read and sorted on the pool
+        [[nodiscard]] static VINIndex Build(const Registry::Reader &registry, Batch::ThreadPool &pool);
+        //  Indexes the valid VIN numbers of the vector, row is the position in the vector
+        [[nodiscard]] static VINIndex Build(const std::vector<std::string> &vins, Batch::ThreadPool &pool);
+
+        //  All entries of the VIN
+        [[nodiscard]] Range<VINEntry> Find(std::string_view vin) const noexcept;
+        //  All entries that start with the prefix (WMI is 3 symbols, WMI and VDS are 9), up to 17 symbols
+        [[nodiscard]] Range<VINEntry> FindPrefix(std::string_view prefix) const noexcept;
+        //  Rows of all VIN numbers with the WMI and the model year in the ascending VIN order,
+        //  a pair of binary searches in the (WMI, model year) column
+        [[nodiscard]] std::vector<std::uint64_t> FindByWMIAndYear(std::string_view wmi, std::uint16_t model_year) const;
+
+        //  All entries in the index order
+        [[nodiscard]] Range<VINEntry> Entries() const noexcept { return {entries.data(), entries.data() + entries.size()}; }
+        [[nodiscard]] std::size_t Size() const noexcept { return entries.size(); }
+    private:
+        //  Entry of the (WMI, model year) column, equal keys keep the order of entries
+        struct YearKey {
+            std::uint64_t key;          // WMI symbols, then the model year
+            std::size_t position;       // Index in entries
+        };
+
+        VINIndex(std::vector<VINEntry> entries, Batch::ThreadPool &pool);
+
+        std::vector<VINEntry> entries;
+        std::vector<YearKey> year_keys;
+    };
+
+    //  Entries are sorted by Mark::Value: region, then series in the order of Mark::Next, then number
+    class MarkIndex {
+    public:
+        MarkIndex() = default;
+        //  Indexes the valid rows of a mark registry, row groups are read and sorted on the pool
+        [[nodiscard]] static MarkIndex Build(const Registry::Reader &registry, Batch::ThreadPool &pool);
+        //  Indexes the valid marks of the vector, row is the position in the vector
+        [[nodiscard]] static MarkIndex Build(const std::vector<std::string> &marks, Batch::ThreadPool &pool);
+
+        [[nodiscard]] Range<MarkEntry> Find(RegMark::Mark mark) const noexcept;
+        //  All marks from first to last including both boundaries, the range may span several regions
+        [[nodiscard]] Range<MarkEntry> FindRange(RegMark::Mark first, RegMark::Mark last) const noexcept;
+        //  All marks of the region with series from first_series to last_series (series indexes, see Mark::Series)
+        [[nodiscard]] Range<MarkEntry> FindSeriesRange(std::uint32_t region, std::uint32_t first_series, std::uint32_t last_series) const noexcept;
+
+        //  All entries in the index order
+        [[nodiscard]] Range<MarkEntry> Entries() const noexcept { return {entries.data(), entries.data() + entries.size()}; }
+        [[nodiscard]] std::size_t Size() const noexcept { return entries.size(); }
+    private:
+        explicit MarkIndex(std::vector<MarkEntry> entries) noexcept : entries(std::move(entries)) {}
+
+        std::vector<MarkEntry> entries;
+    };
+}
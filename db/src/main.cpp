@@ -1,27 +1,133 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <locale>
-#include "vin.hpp"
-#include "reg_mark.hpp"
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "metrics.hpp"
+#include "pipeline.hpp"
+#include "stream_processor.hpp"
+
+const char *usage =
+    "Usage: vin_database [--marks] [--normalize] [--corrections] [--tsv] [--threads N] [--chunk-size BYTES]\n"
+    "                    [--cache ENTRIES] [--pipeline PARSE,VALIDATE,DECODE] [--socket PATH]\n"
+    "                    [--metrics FILE] [--metrics-json FILE] [FILE]\n"
+    "Validates newline-delimited VIN numbers (or license plate numbers with --marks)\n"
+    "from FILE or standard input (when FILE is missing or \"-\") and writes CSV rows\n"
+    "in the input order to standard output:\n"
+    "  VIN:  vin,valid,error,country,year[,corrections]\n"
+    "  mark: mark,valid,error,region\n"
+    "--normalize removes spaces and dashes from VIN numbers, converts them to capital letters\n"
+    "and replaces I with 1, O and Q with 0 before the validation.\n"
+    "--corrections adds the corrections column to the VIN rows: the single-symbol substitutions\n"
+    "that make an invalid VIN valid, as POSITION:SYMBOL (1-based) separated by spaces.\n"
+    "--cache keeps up to ENTRIES decoded VIN numbers for feeds that repeat the same vehicles.\n"
+    "--pipeline runs the staged pipeline with the given worker counts (0 is the default)\n"
+    "instead of the chunked one, rows of different batches may be written in any order.\n"
+    "--socket writes the rows to the local socket PATH through the pipeline.\n"
+    "--metrics and --metrics-json write the call counters in Prometheus text or JSON format\n"
+    "when the input is processed (the build needs -DVIN_METRICS=ON).\n";
 
 int main (int argc, char *argv[]) 
 {
-    const std::string vin = "19VDE1F75FE004339";
     std::setlocale(LC_ALL, "");
-    if (VIN::checkVIN(vin)) {
-        std::cout << "Success\n";
-        std::cout << VIN::getVINCountry(vin) << '\n';
-        std::cout << "Year of vehicle: " << VIN::getTransportYear(vin) << '\n';
+    Batch::Options options;
+    const char *input_path = nullptr;
+    std::string metrics_path;
+    Metrics::ExportFormat metrics_format = Metrics::ExportFormat::PROMETHEUS;
+    bool use_pipeline = false;
+    Batch::PipelineOptions pipeline_options;
+    std::string socket_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--marks") {
+            options.kind = Batch::InputKind::MARK;
+        } else if (argument == "--normalize") {
+            options.normalize = true;
+        } else if (argument == "--corrections") {
+            options.corrections = true;
+        } else if (argument == "--tsv") {
+            options.format = Batch::OutputFormat::TSV;
+        } else if ((argument == "--threads" || argument == "--chunk-size" || argument == "--cache") && i + 1 < argc) {
+            const unsigned long long value = std::strtoull(argv[++i], nullptr, 10);
+            if (argument == "--threads")
+                options.threads = value;
+            else if (argument == "--chunk-size")
+                options.chunk_size = value;
+            else
+                options.cache_capacity = value;
+        } else if ((argument == "--metrics" || argument == "--metrics-json") && i + 1 < argc) {
+            metrics_path = argv[++i];
+            metrics_format = argument == "--metrics" ? Metrics::ExportFormat::PROMETHEUS : Metrics::ExportFormat::JSON;
+        } else if (argument == "--pipeline" && i + 1 < argc) {
+            use_pipeline = true;
+            char *position = argv[++i];
+            pipeline_options.parse_workers = std::strtoull(position, &position, 10);
+            if (*position == ',')
+                pipeline_options.validate_workers = std::strtoull(position + 1, &position, 10);
+            if (*position == ',')
+                pipeline_options.decode_workers = std::strtoull(position + 1, &position, 10);
+        } else if (argument == "--socket" && i + 1 < argc) {
+            use_pipeline = true;
+            socket_path = argv[++i];
+        } else if (argument == "--help" || argument == "-h") {
+            std::cout << usage;
+            return 0;
+        } else if (input_path == nullptr && (argument == "-" || argument[0] != '-')) {
+            input_path = argv[i];
+        } else {
+            std::cerr << usage;
+            return 2;
+        }
+    }
+
+    int input_fd = STDIN_FILENO;
+    if (input_path != nullptr && std::strcmp(input_path, "-") != 0) {
+        input_fd = open(input_path, O_RDONLY);
+        if (input_fd < 0) {
+            std::cerr << "Error! Can't open " << input_path << ": " << std::strerror(errno) << '\n';
+            return 1;
+        }
     }
-    else
-        std::cout << "Failure\n";
+    // Large buffer for the output, rows are written in big blocks anyway
+    static char output_buffer[1 << 20];
+    std::setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
 
-    const std::string mark = "A999AA100";
-    if (RegMark::CheckMark(mark)) {
-        std::cout << RegMark::GetNextMarkAfter(mark) << '\n';
-        std::cout << RegMark::GetNextMarkAfterRange(mark, "A998AA100", "B999BB100") << '\n';
-        std::cout << "Success\n";
+    long long lines = 0;
+    if (use_pipeline) {
+        pipeline_options.kind = options.kind;
+        pipeline_options.format = options.format;
+        pipeline_options.cache_capacity = options.cache_capacity;
+        pipeline_options.normalize = options.normalize;
+        pipeline_options.corrections = options.corrections;
+        std::unique_ptr<Batch::Sink> sink;
+        if (!socket_path.empty()) {
+            auto socket_sink = std::make_unique<Batch::SocketSink>(socket_path);
+            if (!socket_sink->IsOpen()) {
+                std::cerr << "Error! Can't connect to " << socket_path << ": " << std::strerror(errno) << '\n';
+                return 1;
+            }
+            sink = std::move(socket_sink);
+        } else {
+            sink = std::make_unique<Batch::FileSink>(stdout);
+        }
+        lines = Batch::processStreamPipelined(input_fd, *sink, pipeline_options);
     } else {
-        std::cout << "Failure\n";
+        lines = Batch::processStream(input_fd, stdout, options);
+    }
+    if (input_fd != STDIN_FILENO)
+        close(input_fd);
+    if (lines < 0) {
+        std::cerr << "Error! Can't read the input or write the rows\n";
+        return 1;
+    }
+    if (!metrics_path.empty() && !Metrics::WriteFile(metrics_path, metrics_format)) {
+        std::cerr << "Error! Can't write " << metrics_path << '\n';
+        return 1;
     }
     return 0;
 }
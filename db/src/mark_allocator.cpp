@@ -0,0 +1,54 @@
+//Thread-safe allocation of russian vehicle marks from a range
+#include "mark_allocator.hpp"
+
+using uint32_t = std::uint32_t;
+using uint64_t = std::uint64_t;
+
+RegMark::MarkAllocator::MarkAllocator(Mark rangeStart, Mark rangeEnd) noexcept
+    : range_start(rangeStart), size(getRangeSize(rangeStart, rangeEnd)) {}
+
+RegMark::MarkAllocator::MarkAllocator(const std::string &rangeStart, const std::string &rangeEnd) noexcept
+    : range_start(Mark::Parse(rangeStart).value_or(Mark())),
+      size(getRangeSize(Mark::Parse(rangeStart), Mark::Parse(rangeEnd))) {}
+
+[[nodiscard]] uint32_t RegMark::MarkAllocator::getRangeSize(std::optional<Mark> rangeStart, std::optional<Mark> rangeEnd) noexcept
+{
+    if (!rangeStart || !rangeEnd || rangeStart->Region() != rangeEnd->Region())
+        return 0;
+    if (rangeStart->Position() > rangeEnd->Position())
+        return 0;
+    return static_cast<uint32_t>(GetCombinationCountInRange(*rangeStart, *rangeEnd));
+}
+
+[[nodiscard]] std::optional<RegMark::Mark> RegMark::MarkAllocator::Allocate() noexcept
+{
+    // Counter may grow past the size, 64 bits never overflow in practice
+    const uint64_t position = next_position.fetch_add(1, std::memory_order_relaxed);
+    if (position >= size)
+        return std::nullopt;
+    return Mark::FromValue(range_start.Value() + static_cast<uint32_t>(position));
+}
+
+[[nodiscard]] std::string RegMark::MarkAllocator::AllocateString()
+{
+    const std::optional<Mark> mark = Allocate();
+    if (!mark)
+        return std::string(out_of_stock);
+    return mark->Format();
+}
+
+[[nodiscard]] RegMark::MarkAllocator::Block RegMark::MarkAllocator::Reserve(uint32_t count) noexcept
+{
+    const uint64_t position = next_position.fetch_add(count, std::memory_order_relaxed);
+    if (position >= size)
+        return {Mark(), 0};
+    const uint64_t available = size - position;
+    return {Mark::FromValue(range_start.Value() + static_cast<uint32_t>(position)),
+            static_cast<uint32_t>(count < available ? count : available)};
+}
+
+[[nodiscard]] uint32_t RegMark::MarkAllocator::Remaining() const noexcept
+{
+    const uint64_t position = next_position.load(std::memory_order_relaxed);
+    return position >= size ? 0 : static_cast<uint32_t>(size - position);
+}
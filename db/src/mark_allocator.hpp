@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include "reg_mark.hpp"
+
+namespace RegMark {
+    //  Thread-safe allocator that hands out every mark from rangeStart to rangeEnd (including both boundaries)
+    //  exactly once and in order, the range has the same meaning as in GetNextMarkAfterRange.
+    //  The next free position is one atomic counter, so allocation is a single fetch-add.
+    //  When the range is exhausted, every following call reports "Out of stock".
+    class MarkAllocator {
+    public:
+        //  Consecutive marks [first, first + count), count is 0 if the range is exhausted
+        struct Block {
+            Mark first;
+            std::uint32_t count;
+        };
+
+        //  Marks must be in the same region and rangeStart must not be after rangeEnd, otherwise the range is empty
+        MarkAllocator(Mark rangeStart, Mark rangeEnd) noexcept;
+        //  Invalid marks give an empty range
+        MarkAllocator(const std::string &rangeStart, const std::string &rangeEnd) noexcept;
+        MarkAllocator(const MarkAllocator &) = delete;
+        MarkAllocator &operator=(const MarkAllocator &) = delete;
+
+        //  Returns the next free mark or nothing if the range is exhausted
+        [[nodiscard]] std::optional<Mark> Allocate() noexcept;
+        //  Same as Allocate, but returns the formatted mark or "Out of stock"
+        [[nodiscard]] std::string AllocateString();
+        //  Reserves up to count consecutive marks with one atomic operation
+        [[nodiscard]] Block Reserve(std::uint32_t count) noexcept;
+        //  Number of marks that are not handed out yet
+        [[nodiscard]] std::uint32_t Remaining() const noexcept;
+        [[nodiscard]] std::uint32_t Size() const noexcept { return size; }
+    private:
+        [[nodiscard]] static std::uint32_t getRangeSize(std::optional<Mark> rangeStart, std::optional<Mark> rangeEnd) noexcept;
+
+        const Mark range_start;
+        const std::uint32_t size;
+        // Counter lives on its own cache line, it's the only thing threads write to
+        alignas(64) std::atomic<std::uint64_t> next_position{0};
+    };
+
+    //  Per-thread front end of MarkAllocator. It reserves blocks of marks from the shared allocator
+    //  and hands them out without atomics. Not thread-safe: create one object per thread.
+    //  Marks are unique across threads, but only ordered within one object.
+    class LocalMarkAllocator {
+    public:
+        explicit LocalMarkAllocator(MarkAllocator &allocator, std::uint32_t block_size = default_block_size) noexcept
+            : allocator(allocator), block_size(block_size == 0 ? 1 : block_size) {}
+
+        [[nodiscard]] std::optional<Mark> Allocate() noexcept
+        {
+            if (block.count == 0) {
+                block = allocator.Reserve(block_size);
+                if (block.count == 0)
+                    return std::nullopt;
+            }
+            const Mark mark = block.first;
+            block.first = Mark::FromValue(mark.Value() + 1);
+            --block.count;
+            return mark;
+        }
+
+        static constexpr std::uint32_t default_block_size = 256;
+    private:
+        MarkAllocator &allocator;
+        const std::uint32_t block_size;
+        MarkAllocator::Block block = {};
+    };
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+//  Constants and error codes of the license plate numbers shared by the header-only plate_format.hpp
+//  and reg_mark.hpp. Nothing here needs the library, so it is installed with plate_format.hpp
+namespace RegMark {
+    //  Three-digit region codes that are valid besides 1..99
+    inline constexpr std::size_t max_unique_codes = 30;
+    inline constexpr std::array<unsigned int, max_unique_codes> unique_region_codes = {102, 111, 113, 116, 121, 123, 124, 159, 125, 126,
+                                                                                     134, 136, 138, 142, 150, 190, 750, 152, 161, 163,
+                                                                                     164, 196, 173, 174, 177, 197, 199, 777, 178, 186};
+    //  Marks of one region: 12 * 12 * 12 series of the numbers 1..999, the packing of Mark (reg_mark.hpp)
+    inline constexpr std::uint32_t marks_in_region = 12 * 12 * 12 * 999;
+
+    enum class MarkError {
+        NONE,
+        INVALID_SIZE,
+        ILLEGAL_SYMBOLS,
+        ILLEGAL_LATIN_SYMBOLS,
+        INVALID_DIGITS,
+        INVALID_SERIES,
+        INVALID_REGION
+    };
+}
@@ -0,0 +1,274 @@
+//Per-thread call counters, latency histograms and their export
+#include "metrics.hpp"
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+using string = std::string;
+using size_t = std::size_t;
+using uint64_t = std::uint64_t;
+
+namespace Metrics {
+    const std::array<std::string_view, function_count> function_names = {
+        "checkVIN", "validateVIN", "checkForIllegalCharacters", "verifyCheckSum", "decode", "getVINCountry",
+        "getTransportYear", "checkVINBatch", "CheckMark", "ValidateMark", "GetNextMarkAfter",
+        "GetNextMarkAfterRange", "GetCombinationCountInRange"
+    };
+
+    void appendPrometheus(string &out, const Snapshot &snapshot);
+    void appendJSON(string &out, const Snapshot &snapshot);
+    void appendNumber(string &out, uint64_t value);
+
+#ifdef VIN_METRICS
+    //  Only the owning thread writes the counters, Collect reads them from other threads
+    struct FunctionCounters {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> total_nanoseconds{0};
+        std::array<std::atomic<uint64_t>, latency_buckets + 1> buckets{};
+    };
+    struct ThreadCounters {
+        std::array<FunctionCounters, function_count> functions;
+        std::array<std::atomic<uint64_t>, vin_error_count> vin_errors{};
+        std::array<std::atomic<uint64_t>, mark_error_count> mark_errors{};
+    };
+    //  Counters of the running threads and the sum of the finished ones
+    struct CounterRegistry {
+        std::mutex mutex;
+        std::vector<const ThreadCounters *> threads;
+        Snapshot finished = {};
+    };
+    //  Registers the counters of the thread for its lifetime
+    class ThreadSlot {
+    public:
+        ThreadSlot();
+        ~ThreadSlot();
+        ThreadCounters counters;
+    };
+
+    [[nodiscard]] CounterRegistry &getRegistry() noexcept;
+    [[nodiscard]] ThreadCounters &getThreadCounters() noexcept;
+    inline void increment(std::atomic<uint64_t> &counter, uint64_t value) noexcept;
+    void addCounters(Snapshot &snapshot, const ThreadCounters &counters) noexcept;
+#endif
+}
+
+[[nodiscard]] std::string_view Metrics::getFunctionName(Function function) noexcept
+{
+    const size_t index = static_cast<size_t>(function);
+    return index < function_count ? function_names[index] : "unknown";
+}
+
+#ifdef VIN_METRICS
+// Function-local, so it outlives the thread_local slots of the main thread
+[[nodiscard]] Metrics::CounterRegistry &Metrics::getRegistry() noexcept
+{
+    static CounterRegistry registry;
+    return registry;
+}
+
+Metrics::ThreadSlot::ThreadSlot()
+{
+    CounterRegistry &registry = getRegistry();
+    const std::lock_guard lock(registry.mutex);
+    registry.threads.push_back(&counters);
+}
+
+// Counters of the finished thread are kept in the registry
+Metrics::ThreadSlot::~ThreadSlot()
+{
+    CounterRegistry &registry = getRegistry();
+    const std::lock_guard lock(registry.mutex);
+    addCounters(registry.finished, counters);
+    std::erase(registry.threads, &counters);
+}
+
+[[nodiscard]] Metrics::ThreadCounters &Metrics::getThreadCounters() noexcept
+{
+    thread_local ThreadSlot slot;
+    return slot.counters;
+}
+
+// Single writer, so there is no need for the locked read-modify-write
+inline void Metrics::increment(std::atomic<uint64_t> &counter, uint64_t value) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void Metrics::addCounters(Snapshot &snapshot, const ThreadCounters &counters) noexcept
+{
+    for (size_t i = 0; i < function_count; ++i) {
+        FunctionStats &stats = snapshot.functions[i];
+        const FunctionCounters &source = counters.functions[i];
+        stats.calls += source.calls.load(std::memory_order_relaxed);
+        stats.total_nanoseconds += source.total_nanoseconds.load(std::memory_order_relaxed);
+        for (size_t bucket = 0; bucket <= latency_buckets; ++bucket)
+            stats.buckets[bucket] += source.buckets[bucket].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < vin_error_count; ++i)
+        snapshot.vin_errors[i] += counters.vin_errors[i].load(std::memory_order_relaxed);
+    for (size_t i = 0; i < mark_error_count; ++i)
+        snapshot.mark_errors[i] += counters.mark_errors[i].load(std::memory_order_relaxed);
+}
+
+void Metrics::recordCall(Function function, uint64_t nanoseconds) noexcept
+{
+    FunctionCounters &counters = getThreadCounters().functions[static_cast<size_t>(function)];
+    increment(counters.calls, 1);
+    increment(counters.total_nanoseconds, nanoseconds);
+    const size_t bucket = std::bit_width(nanoseconds);
+    increment(counters.buckets[bucket < latency_buckets ? bucket : latency_buckets], 1);
+}
+
+void Metrics::recordVINError(VIN::VINError error) noexcept
+{
+    const size_t index = static_cast<size_t>(error);
+    if (index < vin_error_count)
+        increment(getThreadCounters().vin_errors[index], 1);
+}
+
+void Metrics::recordMarkError(RegMark::MarkError error) noexcept
+{
+    const size_t index = static_cast<size_t>(error);
+    if (index < mark_error_count)
+        increment(getThreadCounters().mark_errors[index], 1);
+}
+
+[[nodiscard]] Metrics::Snapshot Metrics::Collect()
+{
+    CounterRegistry &registry = getRegistry();
+    const std::lock_guard lock(registry.mutex);
+    Snapshot snapshot = registry.finished;
+    for (const ThreadCounters *counters : registry.threads)
+        addCounters(snapshot, *counters);
+    snapshot.enabled = true;
+    return snapshot;
+}
+#else
+[[nodiscard]] Metrics::Snapshot Metrics::Collect()
+{
+    return {};
+}
+#endif
+
+void Metrics::appendNumber(string &out, uint64_t value)
+{
+    char number[24];
+    out.append(number, std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value)));
+}
+
+// Histogram buckets are cumulative and measured in seconds, as Prometheus expects
+void Metrics::appendPrometheus(string &out, const Snapshot &snapshot)
+{
+    char number[32];
+    out += "# HELP vin_calls_total Calls of the instrumented functions.\n# TYPE vin_calls_total counter\n";
+    for (size_t i = 0; i < function_count; ++i) {
+        out += "vin_calls_total{function=\"";
+        out += function_names[i];
+        out += "\"} ";
+        appendNumber(out, snapshot.functions[i].calls);
+        out += '\n';
+    }
+    out += "# HELP vin_call_duration_seconds Latency of the instrumented functions.\n# TYPE vin_call_duration_seconds histogram\n";
+    for (size_t i = 0; i < function_count; ++i) {
+        const FunctionStats &stats = snapshot.functions[i];
+        const string labels = "{function=\"" + string(function_names[i]) + "\"";
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket <= latency_buckets; ++bucket) {
+            cumulative += stats.buckets[bucket];
+            out += "vin_call_duration_seconds_bucket" + labels + ",le=\"";
+            if (bucket < latency_buckets)
+                out.append(number, std::snprintf(number, sizeof(number), "%.9g", static_cast<double>(uint64_t{1} << bucket) * 1e-9));
+            else
+                out += "+Inf";
+            out += "\"} ";
+            appendNumber(out, cumulative);
+            out += '\n';
+        }
+        out += "vin_call_duration_seconds_sum" + labels + "} ";
+        out.append(number, std::snprintf(number, sizeof(number), "%.9g", static_cast<double>(stats.total_nanoseconds) * 1e-9));
+        out += "\nvin_call_duration_seconds_count" + labels + "} ";
+        appendNumber(out, stats.calls);
+        out += '\n';
+    }
+    out += "# HELP vin_validations_total Results of validateVIN and ValidateMark by error code.\n# TYPE vin_validations_total counter\n";
+    for (size_t i = 0; i < vin_error_count; ++i) {
+        out += "vin_validations_total{kind=\"vin\",error=\"";
+        out += VIN::getErrorName(static_cast<VIN::VINError>(i));
+        out += "\"} ";
+        appendNumber(out, snapshot.vin_errors[i]);
+        out += '\n';
+    }
+    for (size_t i = 0; i < mark_error_count; ++i) {
+        out += "vin_validations_total{kind=\"mark\",error=\"";
+        out += RegMark::GetErrorName(static_cast<RegMark::MarkError>(i));
+        out += "\"} ";
+        appendNumber(out, snapshot.mark_errors[i]);
+        out += '\n';
+    }
+}
+
+// Bucket i of "buckets" counts the calls shorter than 2^i nanoseconds, the last one counts the rest
+void Metrics::appendJSON(string &out, const Snapshot &snapshot)
+{
+    out += "{\n  \"enabled\": ";
+    out += snapshot.enabled ? "true" : "false";
+    out += ",\n  \"functions\": {";
+    for (size_t i = 0; i < function_count; ++i) {
+        const FunctionStats &stats = snapshot.functions[i];
+        out += i == 0 ? "\n    \"" : ",\n    \"";
+        out += function_names[i];
+        out += "\": {\"calls\": ";
+        appendNumber(out, stats.calls);
+        out += ", \"total_ns\": ";
+        appendNumber(out, stats.total_nanoseconds);
+        out += ", \"buckets\": [";
+        for (size_t bucket = 0; bucket <= latency_buckets; ++bucket) {
+            if (bucket != 0)
+                out += ", ";
+            appendNumber(out, stats.buckets[bucket]);
+        }
+        out += "]}";
+    }
+    out += "\n  },\n  \"validations\": {\n    \"vin\": {";
+    for (size_t i = 0; i < vin_error_count; ++i) {
+        out += i == 0 ? "\"" : ", \"";
+        out += VIN::getErrorName(static_cast<VIN::VINError>(i));
+        out += "\": ";
+        appendNumber(out, snapshot.vin_errors[i]);
+    }
+    out += "},\n    \"mark\": {";
+    for (size_t i = 0; i < mark_error_count; ++i) {
+        out += i == 0 ? "\"" : ", \"";
+        out += RegMark::GetErrorName(static_cast<RegMark::MarkError>(i));
+        out += "\": ";
+        appendNumber(out, snapshot.mark_errors[i]);
+    }
+    out += "}\n  }\n}\n";
+}
+
+[[nodiscard]] string Metrics::Format(const Snapshot &snapshot, ExportFormat format)
+{
+    string out;
+    if (format == ExportFormat::JSON)
+        appendJSON(out, snapshot);
+    else
+        appendPrometheus(out, snapshot);
+    return out;
+}
+
+[[nodiscard]] bool Metrics::WriteFile(const string &path, ExportFormat format)
+{
+    const string text = Format(Collect(), format);
+    const string temporary_path = path + ".tmp";
+    std::FILE *file = std::fopen(temporary_path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    const bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    if (std::fclose(file) != 0 || !written) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+}
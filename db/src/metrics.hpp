@@ -0,0 +1,95 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "reg_mark.hpp"
+#include "vin.hpp"
+
+//  Optional instrumentation of the public functions, enabled by building with VIN_METRICS
+//  (cmake -DVIN_METRICS=ON). Every thread counts calls, latencies and rejection reasons in its own
+//  counters, Collect merges them on demand. Without VIN_METRICS the recording functions are empty
+//  inline functions, Collect returns zeros.
+//  Rejection reasons are counted only by validateVIN and ValidateMark. decode, Mark::Parse and the
+//  other callers use the uncounted findVINError and FindMarkError, so every validated item is counted once.
+namespace Metrics {
+    enum class Function : std::uint8_t {
+        CHECK_VIN,
+        VALIDATE_VIN,
+        CHECK_ILLEGAL_CHARACTERS,   // stage of validateVIN
+        VERIFY_CHECKSUM,            // stage of validateVIN
+        DECODE_VIN,
+        GET_VIN_COUNTRY,
+        GET_TRANSPORT_YEAR,
+        CHECK_VIN_BATCH,
+        CHECK_MARK,
+        VALIDATE_MARK,
+        GET_NEXT_MARK_AFTER,
+        GET_NEXT_MARK_AFTER_RANGE,
+        GET_COMBINATION_COUNT_IN_RANGE,
+        COUNT
+    };
+    enum class ExportFormat {
+        PROMETHEUS,
+        JSON
+    };
+
+    inline constexpr std::size_t function_count = static_cast<std::size_t>(Function::COUNT);
+    inline constexpr std::size_t vin_error_count = static_cast<std::size_t>(VIN::VINError::INVALID_CHECKSUM) + 1;
+    inline constexpr std::size_t mark_error_count = static_cast<std::size_t>(RegMark::MarkError::INVALID_REGION) + 1;
+    //  Bucket i counts calls shorter than 2^i nanoseconds, the last bucket counts the rest
+    inline constexpr std::size_t latency_buckets = 32;
+
+    struct FunctionStats {
+        std::uint64_t calls;
+        std::uint64_t total_nanoseconds;
+        std::array<std::uint64_t, latency_buckets + 1> buckets;
+    };
+    //  Counters of all threads, including the finished ones, at the moment of Collect
+    struct Snapshot {
+        bool enabled;
+        std::array<FunctionStats, function_count> functions;
+        std::array<std::uint64_t, vin_error_count> vin_errors;
+        std::array<std::uint64_t, mark_error_count> mark_errors;
+    };
+
+    [[nodiscard]] std::string_view getFunctionName(Function function) noexcept;
+    [[nodiscard]] Snapshot Collect();
+    [[nodiscard]] std::string Format(const Snapshot &snapshot, ExportFormat format);
+    //  Writes the current counters to a temporary file and renames it to path, so a scraper
+    //  never reads a partially written file. Returns false if the file can't be written
+    [[nodiscard]] bool WriteFile(const std::string &path, ExportFormat format);
+
+#ifdef VIN_METRICS
+    void recordCall(Function function, std::uint64_t nanoseconds) noexcept;
+    void recordVINError(VIN::VINError error) noexcept;
+    void recordMarkError(RegMark::MarkError error) noexcept;
+
+    //  Measures the time until the end of the scope
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Function function) noexcept
+            : function(function), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer()
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            recordCall(function, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+    private:
+        Function function;
+        std::chrono::steady_clock::time_point start;
+    };
+#else
+    inline void recordCall(Function, std::uint64_t) noexcept {}
+    inline void recordVINError(VIN::VINError) noexcept {}
+    inline void recordMarkError(RegMark::MarkError) noexcept {}
+
+    class ScopedTimer {
+    public:
+        explicit constexpr ScopedTimer(Function) noexcept {}
+    };
+#endif
+}
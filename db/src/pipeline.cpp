@@ -0,0 +1,385 @@
+//Staged ingestion pipeline: parse -> validate -> decode -> sink.
+//Blocks of lines are split into batches by the parse workers, batches go through the bounded
+//queues of the next stages and the rows of every batch are written by a single sink thread.
+#include "pipeline.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ring_buffer.hpp"
+#include "vin_cache.hpp"
+
+using string = std::string;
+using size_t = std::size_t;
+using uint64_t = std::uint64_t;
+
+namespace Batch {
+    const size_t pipeline_block_size = 1 << 20;
+    const size_t backoff_yields = 16;
+    const auto backoff_sleep = std::chrono::microseconds(20);
+
+    //  Lines of one batch point into the block they were parsed from
+    struct RecordBatch {
+        std::shared_ptr<string> block;
+        std::vector<std::string_view> lines;
+        std::vector<std::uint8_t> errors;
+        string rows;
+        size_t count = 0;
+    };
+    using BlockPointer = std::shared_ptr<string>;
+    using BatchPointer = std::unique_ptr<RecordBatch>;
+
+    //  Yields a few times, then sleeps, so idle workers don't burn a core
+    class Backoff {
+    public:
+        void Wait()
+        {
+            if (yields < backoff_yields) {
+                ++yields;
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(backoff_sleep);
+            }
+        }
+    private:
+        size_t yields = 0;
+    };
+
+    //  Bounded queue between two stages. Close is called once all producers are done, after that
+    //  Pop drains the queue and returns false
+    template <typename T>
+    class Channel {
+    public:
+        Channel(size_t capacity, bool single_threaded)
+        {
+            if (single_threaded)
+                spsc = std::make_unique<SPSCRing<T>>(capacity);
+            else
+                mpmc = std::make_unique<MPMCRing<T>>(capacity);
+        }
+        void Push(T &value, std::atomic<uint64_t> &stalls)
+        {
+            if (tryPush(value))
+                return;
+            stalls.fetch_add(1, std::memory_order_relaxed);
+            Backoff backoff;
+            while (!tryPush(value))
+                backoff.Wait();
+        }
+        [[nodiscard]] bool Pop(T &value)
+        {
+            Backoff backoff;
+            for (;;) {
+                if (tryPop(value))
+                    return true;
+                // Every push happened before Close, so one more try sees all of them
+                if (closed.load(std::memory_order_acquire))
+                    return tryPop(value);
+                backoff.Wait();
+            }
+        }
+        void Close() noexcept { closed.store(true, std::memory_order_release); }
+    private:
+        [[nodiscard]] bool tryPush(T &value) { return spsc ? spsc->TryPush(value) : mpmc->TryPush(value); }
+        [[nodiscard]] bool tryPop(T &value) { return spsc ? spsc->TryPop(value) : mpmc->TryPop(value); }
+
+        std::unique_ptr<SPSCRing<T>> spsc;
+        std::unique_ptr<MPMCRing<T>> mpmc;
+        std::atomic<bool> closed{false};
+    };
+
+    [[nodiscard]] size_t getWorkerCount(size_t workers) noexcept;
+}
+
+struct Batch::Pipeline::Impl {
+    Impl(const PipelineOptions &options, Sink &sink);
+
+    void parse();
+    void validate();
+    void decode();
+    void write();
+
+    const PipelineOptions options;
+    Sink &sink;
+    std::unique_ptr<VIN::DecodeCache> cache;
+    const size_t parse_workers;
+    const size_t validate_workers;
+    const size_t decode_workers;
+    Channel<BlockPointer> blocks;
+    Channel<BatchPointer> parsed;
+    Channel<BatchPointer> validated;
+    Channel<BatchPointer> decoded;
+    // The last worker of a stage closes the queue of the next one
+    std::atomic<size_t> parse_active;
+    std::atomic<size_t> validate_active;
+    std::atomic<size_t> decode_active;
+    std::atomic<uint64_t> lines{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> stalls{0};
+    std::vector<std::thread> threads;
+    bool sink_failed = false;   // Written by the sink thread, read after it is joined
+    bool finished = false;
+};
+
+Batch::Pipeline::Impl::Impl(const PipelineOptions &options, Sink &sink)
+    : options(options), sink(sink),
+      parse_workers(options.parse_workers == 0 ? 1 : options.parse_workers),
+      validate_workers(getWorkerCount(options.validate_workers)),
+      decode_workers(getWorkerCount(options.decode_workers)),
+      blocks(options.queue_capacity, false),
+      parsed(options.queue_capacity, parse_workers == 1 && validate_workers == 1),
+      validated(options.queue_capacity, validate_workers == 1 && decode_workers == 1),
+      decoded(options.queue_capacity, decode_workers == 1),
+      parse_active(parse_workers), validate_active(validate_workers), decode_active(decode_workers)
+{
+    if (options.kind == InputKind::VIN && options.cache_capacity != 0)
+        cache = std::make_unique<VIN::DecodeCache>(options.cache_capacity);
+}
+
+[[nodiscard]] size_t Batch::getWorkerCount(size_t workers) noexcept
+{
+    if (workers != 0)
+        return workers;
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads < 4 ? 1 : hardware_threads / 2;
+}
+
+// Lines are cut the same way as in processStream: the last line may have no newline, \r is dropped.
+// VIN numbers are normalized in place, the block isn't shared with the other stages yet
+void Batch::Pipeline::Impl::parse()
+{
+    const size_t batch_size = options.batch_size == 0 ? 1 : options.batch_size;
+    const bool normalize = options.normalize && options.kind == InputKind::VIN;
+    BlockPointer block;
+    while (blocks.Pop(block)) {
+        std::string_view data = *block;
+        char *const block_data = block->data();
+        BatchPointer batch;
+        while (!data.empty()) {
+            if (!batch) {
+                batch = std::make_unique<RecordBatch>();
+                batch->block = block;
+                batch->lines.reserve(batch_size);
+            }
+            const size_t line_end = data.find('\n');
+            std::string_view line = data.substr(0, line_end);
+            data.remove_prefix(line_end == std::string_view::npos ? data.size() : line_end + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (normalize) {
+                char *const line_data = block_data + (line.data() - block->data());
+                line = std::string_view(line_data, VIN::normalizeVIN(line_data, line.size()));
+            }
+            batch->lines.push_back(line);
+            if (batch->lines.size() == batch_size)
+                parsed.Push(batch, stalls);
+        }
+        if (batch)
+            parsed.Push(batch, stalls);
+        block.reset();
+    }
+    if (parse_active.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        parsed.Close();
+}
+
+void Batch::Pipeline::Impl::validate()
+{
+    BatchPointer batch;
+    while (parsed.Pop(batch)) {
+        std::vector<std::uint8_t> &errors = batch->errors;
+        errors.resize(batch->lines.size());
+        if (options.kind == InputKind::VIN) {
+            for (size_t i = 0; i < errors.size(); ++i)
+                errors[i] = static_cast<std::uint8_t>(VIN::validateVIN(batch->lines[i]));
+        } else {
+            for (size_t i = 0; i < errors.size(); ++i)
+                errors[i] = static_cast<std::uint8_t>(RegMark::ValidateMark(batch->lines[i]));
+        }
+        validated.Push(batch, stalls);
+    }
+    if (validate_active.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        validated.Close();
+}
+
+// Lines are already validated, so only the remaining fields are decoded. Rows own their data,
+// the block is released here
+void Batch::Pipeline::Impl::decode()
+{
+    BatchPointer batch;
+    while (validated.Pop(batch)) {
+        string &rows = batch->rows;
+        for (size_t i = 0; i < batch->lines.size(); ++i) {
+            const std::string_view line = batch->lines[i];
+            if (options.kind == InputKind::VIN) {
+                const auto error = static_cast<VIN::VINError>(batch->errors[i]);
+                appendVINRow(rows, line, decodeValidatedVIN(line, error, cache.get()), options.format, options.corrections);
+            } else {
+                const auto error = static_cast<RegMark::MarkError>(batch->errors[i]);
+                appendMarkRow(rows, line, error, error == RegMark::MarkError::NONE ? getMarkRegion(line) : 0, options.format);
+            }
+        }
+        batch->count = batch->lines.size();
+        batch->lines = {};
+        batch->errors = {};
+        batch->block.reset();
+        decoded.Push(batch, stalls);
+    }
+    if (decode_active.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        decoded.Close();
+}
+
+// After a failed write the batches are still taken from the queue, so the other stages never block
+void Batch::Pipeline::Impl::write()
+{
+    BatchPointer batch;
+    while (decoded.Pop(batch)) {
+        if (!sink_failed)
+            sink_failed = !sink.Write(batch->rows);
+        lines.fetch_add(batch->count, std::memory_order_relaxed);
+        batches.fetch_add(1, std::memory_order_relaxed);
+        batch.reset();
+    }
+}
+
+Batch::Pipeline::Pipeline(const PipelineOptions &options, Sink &sink)
+    : impl(std::make_unique<Impl>(options, sink))
+{
+    string header;
+    appendHeader(header, options.kind, options.format, options.corrections);
+    impl->sink_failed = !sink.Write(header);
+
+    Impl &stages = *impl;
+    for (size_t i = 0; i < stages.parse_workers; ++i)
+        stages.threads.emplace_back([&stages] { stages.parse(); });
+    for (size_t i = 0; i < stages.validate_workers; ++i)
+        stages.threads.emplace_back([&stages] { stages.validate(); });
+    for (size_t i = 0; i < stages.decode_workers; ++i)
+        stages.threads.emplace_back([&stages] { stages.decode(); });
+    stages.threads.emplace_back([&stages] { stages.write(); });
+}
+
+Batch::Pipeline::~Pipeline()
+{
+    Finish();
+}
+
+void Batch::Pipeline::Submit(string block)
+{
+    if (block.empty())
+        return;
+    BlockPointer pointer = std::make_shared<string>(std::move(block));
+    impl->blocks.Push(pointer, impl->stalls);
+}
+
+long long Batch::Pipeline::Finish()
+{
+    if (!impl->finished) {
+        impl->finished = true;
+        impl->blocks.Close();
+        for (auto &thread : impl->threads)
+            thread.join();
+        impl->threads.clear();
+        if (!impl->sink.Flush())
+            impl->sink_failed = true;
+    }
+    return impl->sink_failed ? -1 : static_cast<long long>(impl->lines.load(std::memory_order_relaxed));
+}
+
+[[nodiscard]] Batch::Pipeline::Stats Batch::Pipeline::GetStats() const noexcept
+{
+    return {impl->lines.load(std::memory_order_relaxed), impl->batches.load(std::memory_order_relaxed),
+            impl->stalls.load(std::memory_order_relaxed)};
+}
+
+Batch::FileSink::FileSink(const string &path)
+    : file(std::fopen(path.c_str(), "wb")), owned(true)
+{
+}
+
+Batch::FileSink::~FileSink()
+{
+    if (owned && file != nullptr)
+        std::fclose(file);
+}
+
+[[nodiscard]] bool Batch::FileSink::Write(std::string_view rows)
+{
+    return file != nullptr && std::fwrite(rows.data(), 1, rows.size(), file) == rows.size();
+}
+
+[[nodiscard]] bool Batch::FileSink::Flush()
+{
+    return file != nullptr && std::fflush(file) == 0;
+}
+
+Batch::SocketSink::SocketSink(const string &path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return;
+    path.copy(address.sun_path, path.size());
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+Batch::SocketSink::~SocketSink()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+// MSG_NOSIGNAL: a closed reader gives an error instead of SIGPIPE
+[[nodiscard]] bool Batch::SocketSink::Write(std::string_view rows)
+{
+    while (!rows.empty() && fd >= 0) {
+        const ssize_t count = send(fd, rows.data(), rows.size(), MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        rows.remove_prefix(count);
+    }
+    return fd >= 0;
+}
+
+// The unfinished line at the end of a block is carried over to the next one
+long long Batch::processStreamPipelined(int input_fd, Sink &sink, const PipelineOptions &options)
+{
+    Pipeline pipeline(options, sink);
+    string carry;
+    std::vector<char> buffer(pipeline_block_size);
+    bool read_failed = false;
+    for (;;) {
+        const ssize_t count = read(input_fd, buffer.data(), buffer.size());
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            read_failed = true;
+            break;
+        }
+        if (count == 0)
+            break;
+        const std::string_view data(buffer.data(), count);
+        const size_t line_end = data.rfind('\n');
+        if (line_end == std::string_view::npos) {
+            carry += data;
+            continue;
+        }
+        string block = std::move(carry);
+        block += data.substr(0, line_end + 1);
+        carry = string(data.substr(line_end + 1));
+        pipeline.Submit(std::move(block));
+    }
+    pipeline.Submit(std::move(carry));
+    const long long lines = pipeline.Finish();
+    return read_failed ? -1 : lines;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "stream_processor.hpp"
+
+namespace Batch {
+    //  Destination of the pipeline rows. Write is called from one thread only
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        //  Returns false if the rows can't be written, the pipeline drops the rest of the rows then
+        [[nodiscard]] virtual bool Write(std::string_view rows) = 0;
+        [[nodiscard]] virtual bool Flush() { return true; }
+    };
+
+    //  Writes to a stdio stream, the stream is closed only if the sink opened it
+    class FileSink : public Sink {
+    public:
+        explicit FileSink(std::FILE *file) noexcept : file(file), owned(false) {}
+        explicit FileSink(const std::string &path);
+        ~FileSink() override;
+        FileSink(const FileSink &) = delete;
+        FileSink &operator=(const FileSink &) = delete;
+
+        [[nodiscard]] bool IsOpen() const noexcept { return file != nullptr; }
+        [[nodiscard]] bool Write(std::string_view rows) override;
+        [[nodiscard]] bool Flush() override;
+    private:
+        std::FILE *file;
+        bool owned;
+    };
+
+    //  Streams the rows to a local (unix domain) socket
+    class SocketSink : public Sink {
+    public:
+        explicit SocketSink(const std::string &path);
+        ~SocketSink() override;
+        SocketSink(const SocketSink &) = delete;
+        SocketSink &operator=(const SocketSink &) = delete;
+
+        [[nodiscard]] bool IsOpen() const noexcept { return fd >= 0; }
+        [[nodiscard]] bool Write(std::string_view rows) override;
+    private:
+        int fd = -1;
+    };
+
+    struct PipelineOptions {
+        InputKind kind = InputKind::VIN;
+        OutputFormat format = OutputFormat::CSV;
+        std::size_t parse_workers = 1;
+        std::size_t validate_workers = 0;       // 0 means half of the hardware threads
+        std::size_t decode_workers = 0;         // 0 means half of the hardware threads
+        std::size_t batch_size = 1024;          // Lines passed between the stages at once
+        std::size_t queue_capacity = 64;        // Blocks or batches held by every queue
+        std::size_t cache_capacity = 0;         // Decoded VIN numbers kept in VIN::DecodeCache, 0 disables it
+        bool normalize = false;                 // VIN numbers go through VIN::normalizeVIN first
+        bool corrections = false;               // VIN rows get the column of VIN::findCorrections
+    };
+
+    //  Staged ingestion: parse -> validate -> decode -> sink. Every stage has its own worker threads,
+    //  the stages are connected by bounded lock-free queues (SPSC when both sides have a single
+    //  thread, MPMC otherwise) that carry batches of lines. A full queue blocks the stage before it,
+    //  so a slow sink slows down Submit instead of growing the memory.
+    //  Rows of a block stay together in a batch, but batches may be written in any order.
+    class Pipeline {
+    public:
+        struct Stats {
+            std::uint64_t lines;            // Rows written to the sink
+            std::uint64_t batches;
+            std::uint64_t stalls;           // Pushes that had to wait for a full queue
+        };
+
+        //  Writes the header to the sink and starts the workers
+        Pipeline(const PipelineOptions &options, Sink &sink);
+        //  Same as Finish
+        ~Pipeline();
+        Pipeline(const Pipeline &) = delete;
+        Pipeline &operator=(const Pipeline &) = delete;
+
+        //  Queues newline-delimited lines, can be called from any number of threads until Finish.
+        //  Blocks while the parse queue is full
+        void Submit(std::string block);
+        //  Waits until every submitted line is written and stops the workers.
+        //  Returns the number of written lines or -1 if the sink failed
+        long long Finish();
+        [[nodiscard]] Stats GetStats() const noexcept;
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+    };
+
+    //  processStream through the pipeline: the input is read in blocks and written to the sink.
+    //  Returns the number of processed lines or -1 if the input can't be read or the sink failed
+    long long processStreamPipelined(int input_fd, Sink &sink, const PipelineOptions &options);
+}
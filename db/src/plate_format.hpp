@@ -0,0 +1,333 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include "mark_core.hpp"
+
+//  Compile-time descriptors of the license plate formats. A format is a pattern of symbol classes:
+//    a - series letter (ABCEHKMOPTXY), 9 - digit of the number, r - digit of the region
+//  Every PlateFormat gets its own validator, parser and encoder. Positions of the symbol classes are
+//  template arguments, so every check is a fold expression over the positions without loops or
+//  index skipping.
+namespace RegMark {
+    inline constexpr std::string_view series_symbols = "ABCEHKMOPTXY";
+    //  Latin letters that have no cyrillic look-alike
+    inline constexpr std::string_view illegal_latin_symbols = "DFGIJLNQRSUVWZ";
+
+    //  How the region digits are read
+    enum class RegionCoding : std::uint8_t {
+        PLAIN,      // Digits as written
+        PADDED      // Three region digits: 0d0 and dd0 are one and two digit regions, ddd is a three digit one.
+                    // Two digit regions whose dd0 is a three digit region (15, 19, 75) are written as 0dd
+    };
+
+    //  Pattern string usable as a template argument: PlateFormat<"a999aarr">
+    template <std::size_t Size>
+    struct FormatPattern {
+        std::array<char, Size> symbols;
+
+        constexpr FormatPattern(const char (&pattern)[Size + 1]) noexcept : symbols()
+        {
+            for (std::size_t i = 0; i < Size; ++i)
+                symbols[i] = pattern[i];
+        }
+        [[nodiscard]] constexpr std::size_t Count(char symbol_class) const noexcept
+        {
+            std::size_t count = 0;
+            for (const char symbol : symbols)
+                count += symbol == symbol_class;
+            return count;
+        }
+    };
+    template <std::size_t Size>
+    FormatPattern(const char (&)[Size]) -> FormatPattern<Size - 1>;
+
+    //  Series is the index of the letters in series_symbols, the first letter is the most significant
+    struct PlateParts {
+        std::uint32_t series;
+        std::uint32_t number;
+        std::uint32_t region;
+    };
+
+    //  Classes of the plate symbols, the validators look every symbol up in plate_symbol_classes
+    enum PlateSymbolClass : std::uint8_t {
+        PLATE_ALNUM = 1,            // Digit or latin letter
+        PLATE_ILLEGAL_LATIN = 2,    // Letter of illegal_latin_symbols
+        PLATE_DIGIT = 4,
+        PLATE_SERIES = 8            // Letter of series_symbols
+    };
+
+    [[nodiscard]] constexpr std::array<std::uint8_t, 256> makePlateSymbolClasses() noexcept
+    {
+        std::array<std::uint8_t, 256> classes = {};
+        for (int symbol = '0'; symbol <= '9'; ++symbol)
+            classes[symbol] = PLATE_ALNUM | PLATE_DIGIT;
+        for (int symbol = 'A'; symbol <= 'Z'; ++symbol)
+            classes[symbol] = classes[symbol - 'A' + 'a'] = PLATE_ALNUM;
+        for (const char symbol : illegal_latin_symbols)
+            classes[static_cast<unsigned char>(symbol)] |= PLATE_ILLEGAL_LATIN;
+        for (const char symbol : series_symbols)
+            classes[static_cast<unsigned char>(symbol)] |= PLATE_SERIES;
+        return classes;
+    }
+    //  Position of the letter in series_symbols, 0 for the other symbols
+    [[nodiscard]] constexpr std::array<std::uint8_t, 256> makeSeriesIndexes() noexcept
+    {
+        std::array<std::uint8_t, 256> indexes = {};
+        for (std::size_t i = 0; i < series_symbols.size(); ++i)
+            indexes[static_cast<unsigned char>(series_symbols[i])] = static_cast<std::uint8_t>(i);
+        return indexes;
+    }
+    inline constexpr std::array<std::uint8_t, 256> plate_symbol_classes = makePlateSymbolClasses();
+    inline constexpr std::array<std::uint8_t, 256> series_indexes = makeSeriesIndexes();
+    static_assert(plate_symbol_classes['D'] == (PLATE_ALNUM | PLATE_ILLEGAL_LATIN) && plate_symbol_classes['X'] == (PLATE_ALNUM | PLATE_SERIES));
+    static_assert(series_indexes['A'] == 0 && series_indexes['Y'] == series_symbols.size() - 1);
+
+    [[nodiscard]] constexpr std::uint8_t getSymbolClass(char symbol) noexcept
+    {
+        return plate_symbol_classes[static_cast<unsigned char>(symbol)];
+    }
+    [[nodiscard]] constexpr bool isDigitSymbol(char symbol) noexcept { return getSymbolClass(symbol) & PLATE_DIGIT; }
+    [[nodiscard]] constexpr std::uint32_t getPower(std::size_t base, std::size_t exponent) noexcept
+    {
+        std::uint32_t result = 1;
+        for (std::size_t i = 0; i < exponent; ++i)
+            result *= static_cast<std::uint32_t>(base);
+        return result;
+    }
+    //  Regions 1..99 and the three-digit codes of unique_region_codes
+    [[nodiscard]] constexpr bool IsRegionCodeValid(std::uint32_t region) noexcept
+    {
+        if (region >= 1 && region <= 99)
+            return true;
+        for (const auto code : unique_region_codes) {
+            if (region == code)
+                return true;
+        }
+        return false;
+    }
+
+    template <FormatPattern Pattern, RegionCoding Coding = RegionCoding::PLAIN>
+    class PlateFormat {
+    public:
+        static constexpr std::size_t size = Pattern.symbols.size();
+        static constexpr std::size_t series_letters = Pattern.Count('a');
+        static constexpr std::size_t number_digits = Pattern.Count('9');
+        static constexpr std::size_t region_digits = Pattern.Count('r');
+        static_assert(series_letters + number_digits + region_digits == size, "Unknown symbol class in the pattern");
+        static_assert(Coding == RegionCoding::PLAIN || region_digits == 3, "Padded regions have three digits");
+
+        static constexpr std::uint32_t series_count = getPower(series_symbols.size(), series_letters);
+        static constexpr std::uint32_t max_number = getPower(10, number_digits) - 1;
+        static constexpr std::uint32_t max_region = getPower(10, region_digits) - 1;
+        static constexpr std::uint32_t plates_in_region = series_count * max_number;
+        static_assert(static_cast<std::uint64_t>(plates_in_region) * (max_region + 1) <= UINT32_MAX, "Plates don't fit in 32 bits");
+
+        //  Same checks and error order as ValidateMark
+        [[nodiscard]] static constexpr MarkError Validate(std::string_view plate) noexcept
+        {
+            if (plate.size() != size)
+                return MarkError::INVALID_SIZE;
+            return validate(plate, std::make_index_sequence<size>());
+        }
+        //  Returns nothing if the plate is invalid
+        [[nodiscard]] static constexpr std::optional<PlateParts> Parse(std::string_view plate) noexcept
+        {
+            if (Validate(plate) != MarkError::NONE)
+                return std::nullopt;
+            return GetParts(plate);
+        }
+        //  Parts of a plate that passed Validate, without any checks
+        [[nodiscard]] static constexpr PlateParts GetParts(std::string_view plate) noexcept
+        {
+            return getParts(plate, std::make_index_sequence<size>());
+        }
+        //  Region is the most significant part, then the series and the number, like Mark::Value
+        [[nodiscard]] static constexpr std::uint32_t Encode(const PlateParts &parts) noexcept
+        {
+            return parts.region * plates_in_region + parts.series * max_number + parts.number - 1;
+        }
+        [[nodiscard]] static constexpr PlateParts Decode(std::uint32_t value) noexcept
+        {
+            const std::uint32_t position = value % plates_in_region;
+            return {position / max_number, position % max_number + 1, value / plates_in_region};
+        }
+        //  Writes size symbols of the plate
+        static constexpr void FormatTo(const PlateParts &parts, char *out) noexcept
+        {
+            PlateParts rest = parts;
+            // One and two digit regions are written as 0d0 and dd0, or as 0dd if dd0 is a three digit region
+            if constexpr (Coding == RegionCoding::PADDED) {
+                if (rest.region < 100 && !isThreeDigitRegion(rest.region * 10))
+                    rest.region *= 10;
+            }
+            formatTo(rest, out, std::make_index_sequence<size>());
+        }
+    private:
+        [[nodiscard]] static constexpr bool isThreeDigitRegion(std::uint32_t region) noexcept
+        {
+            return region >= 100 && IsRegionCodeValid(region);
+        }
+
+        // Classes of all symbols are looked up once, the first failed class of checks gives the error
+        template <std::size_t... I>
+        [[nodiscard]] static constexpr MarkError validate(std::string_view plate, std::index_sequence<I...>) noexcept
+        {
+            const std::array<std::uint8_t, size> classes = {getSymbolClass(plate[I])...};
+            if (!((classes[I] & PLATE_ALNUM) & ...))
+                return MarkError::ILLEGAL_SYMBOLS;
+            if ((classes[I] | ...) & PLATE_ILLEGAL_LATIN)
+                return MarkError::ILLEGAL_LATIN_SYMBOLS;
+            if (!((Pattern.symbols[I] == 'a' || (classes[I] & PLATE_DIGIT)) && ...))
+                return MarkError::INVALID_DIGITS;
+            // Number 0 is never issued
+            if (!((Pattern.symbols[I] == '9' && plate[I] != '0') || ...))
+                return MarkError::INVALID_DIGITS;
+            if (!((Pattern.symbols[I] != 'a' || (classes[I] & PLATE_SERIES)) && ...))
+                return MarkError::INVALID_SERIES;
+            if (!IsRegionCodeValid(getRegion(plate, std::make_index_sequence<size>())))
+                return MarkError::INVALID_REGION;
+            return MarkError::NONE;
+        }
+
+        template <std::size_t... I>
+        [[nodiscard]] static constexpr std::uint32_t getRegion(std::string_view plate, std::index_sequence<I...>) noexcept
+        {
+            std::uint32_t region = 0;
+            ((region = Pattern.symbols[I] == 'r' ? region * 10 + static_cast<std::uint32_t>(plate[I] - '0') : region), ...);
+            // 0d0 and dd0 are both the written region multiplied by 10, unless it is a three digit region like 190
+            if constexpr (Coding == RegionCoding::PADDED)
+                return region % 10 == 0 && !isThreeDigitRegion(region) ? region / 10 : region;
+            return region;
+        }
+
+        template <std::size_t... I>
+        [[nodiscard]] static constexpr PlateParts getParts(std::string_view plate, std::index_sequence<I...>) noexcept
+        {
+            PlateParts parts = {0, 0, getRegion(plate, std::make_index_sequence<size>())};
+            ((parts.series = Pattern.symbols[I] == 'a' ? parts.series * static_cast<std::uint32_t>(series_symbols.size()) + series_indexes[static_cast<unsigned char>(plate[I])] : parts.series), ...);
+            ((parts.number = Pattern.symbols[I] == '9' ? parts.number * 10 + static_cast<std::uint32_t>(plate[I] - '0') : parts.number), ...);
+            return parts;
+        }
+
+        // Symbols are written from the last one, so every class is divided by its base
+        template <std::size_t... I>
+        static constexpr void formatTo(PlateParts rest, char *out, std::index_sequence<I...>) noexcept
+        {
+            ((Pattern.symbols[size - 1 - I] == 'a'
+                  ? (out[size - 1 - I] = series_symbols[rest.series % series_symbols.size()], rest.series /= series_symbols.size())
+                  : Pattern.symbols[size - 1 - I] == '9'
+                  ? (out[size - 1 - I] = static_cast<char>('0' + rest.number % 10), rest.number /= 10)
+                  : (out[size - 1 - I] = static_cast<char>('0' + rest.region % 10), rest.region /= 10)), ...);
+        }
+    };
+
+    //  Private car plates: a999aa999 (9 symbols, padded region, the format of Mark) and a999aa99
+    using PrivateFormat = PlateFormat<"a999aarrr", RegionCoding::PADDED>;
+    using PrivateShortFormat = PlateFormat<"a999aarr">;
+    //  Trailer plates aa9999 with a two-digit region
+    using TrailerFormat = PlateFormat<"aa9999rr">;
+    //  Taxi plates aa999 with a two-digit region
+    using TaxiFormat = PlateFormat<"aa999rr">;
+    static_assert(PrivateFormat::plates_in_region == marks_in_region);
+    static_assert(PrivateShortFormat::plates_in_region == marks_in_region);
+
+    enum class PlateKind : std::uint8_t {
+        UNKNOWN,
+        PRIVATE,
+        TRAILER,
+        TAXI
+    };
+    //  Plate packed into an integer of its format, values of different kinds overlap
+    struct EncodedPlate {
+        PlateKind kind;
+        std::uint32_t value;
+    };
+
+    //  The format is chosen by the size and, for 8 symbols, by the second symbol (digit for private plates)
+    [[nodiscard]] constexpr PlateKind DetectPlateKind(std::string_view plate) noexcept
+    {
+        switch (plate.size()) {
+        case PrivateFormat::size:
+            return PlateKind::PRIVATE;
+        case TrailerFormat::size:
+            return isDigitSymbol(plate[1]) ? PlateKind::PRIVATE : PlateKind::TRAILER;
+        case TaxiFormat::size:
+            return PlateKind::TAXI;
+        default:
+            return PlateKind::UNKNOWN;
+        }
+    }
+    //  Same checks as ValidateMark, without the metrics: a999aa999 or a999aa99, the size selects the format
+    [[nodiscard]] constexpr MarkError FindMarkError(std::string_view mark) noexcept
+    {
+        switch (mark.size()) {
+        case PrivateFormat::size:
+            return PrivateFormat::Validate(mark);
+        case PrivateShortFormat::size:
+            return PrivateShortFormat::Validate(mark);
+        default:
+            return MarkError::INVALID_SIZE;
+        }
+    }
+    //  Validates a plate of any supported format
+    [[nodiscard]] constexpr MarkError ValidatePlate(std::string_view plate) noexcept
+    {
+        switch (DetectPlateKind(plate)) {
+        case PlateKind::PRIVATE:
+            return FindMarkError(plate);
+        case PlateKind::TRAILER:
+            return TrailerFormat::Validate(plate);
+        case PlateKind::TAXI:
+            return TaxiFormat::Validate(plate);
+        default:
+            return MarkError::INVALID_SIZE;
+        }
+    }
+    //  Returns the format and the parts of a valid plate of any supported format
+    [[nodiscard]] constexpr std::optional<PlateParts> ParsePlate(std::string_view plate, PlateKind &kind) noexcept
+    {
+        kind = DetectPlateKind(plate);
+        switch (kind) {
+        case PlateKind::PRIVATE:
+            return plate.size() == PrivateFormat::size ? PrivateFormat::Parse(plate) : PrivateShortFormat::Parse(plate);
+        case PlateKind::TRAILER:
+            return TrailerFormat::Parse(plate);
+        case PlateKind::TAXI:
+            return TaxiFormat::Parse(plate);
+        default:
+            return std::nullopt;
+        }
+    }
+    //  Private plates are encoded as Mark::Value in both sizes
+    [[nodiscard]] constexpr std::optional<EncodedPlate> EncodePlate(std::string_view plate) noexcept
+    {
+        PlateKind kind = PlateKind::UNKNOWN;
+        const std::optional<PlateParts> parts = ParsePlate(plate, kind);
+        if (!parts)
+            return std::nullopt;
+        switch (kind) {
+        case PlateKind::TRAILER:
+            return EncodedPlate{kind, TrailerFormat::Encode(*parts)};
+        case PlateKind::TAXI:
+            return EncodedPlate{kind, TaxiFormat::Encode(*parts)};
+        default:
+            return EncodedPlate{kind, PrivateFormat::Encode(*parts)};
+        }
+    }
+
+    static_assert(PrivateFormat::Validate("A123BC770") == MarkError::NONE);
+    static_assert(PrivateFormat::Parse("A123BC770")->region == 77 && PrivateFormat::Parse("A123BC050")->region == 5);
+    static_assert(PrivateFormat::Parse("A123BC177")->region == 177 && PrivateFormat::Parse("A123BC102")->region == 102);
+    static_assert(PrivateFormat::Parse("A123BC190")->region == 190 && PrivateFormat::Parse("A123BC750")->region == 750
+                  && PrivateFormat::Parse("A123BC019")->region == 19);
+    static_assert(PrivateShortFormat::Parse("A123BC77")->region == 77 && PrivateShortFormat::Parse("A123BC05")->region == 5);
+    static_assert(PrivateFormat::Validate("A123BC000") == MarkError::INVALID_REGION);
+    static_assert(FindMarkError("A123BC77") == MarkError::NONE && FindMarkError("AB123477") == MarkError::INVALID_DIGITS);
+    static_assert(FindMarkError("A000BC77") == MarkError::INVALID_DIGITS && FindMarkError("A000BC000") == MarkError::INVALID_DIGITS);
+    static_assert(ValidatePlate("AB123477") == MarkError::NONE && ValidatePlate("AB12377") == MarkError::NONE);
+    static_assert(ValidatePlate("A12BC77") == MarkError::INVALID_DIGITS && ValidatePlate("D123BC77") == MarkError::ILLEGAL_LATIN_SYMBOLS);
+}
@@ -0,0 +1,457 @@
+//Issued license plate numbers kept in roaring-style compressed bitmaps, one per region
+#include "plate_inventory.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+using size_t = std::size_t;
+using uint16_t = std::uint16_t;
+using uint32_t = std::uint32_t;
+using uint64_t = std::uint64_t;
+
+namespace RegMark {
+    const char inventory_magic[8] = {'P', 'L', 'A', 'T', 'E', 'I', 'N', 'V'};
+    //  Version 1 had no bitmap flag, its containers were bitmaps past array_container_limit positions
+    const uint32_t inventory_version = 2;
+    const uint32_t inventory_byte_order_mark = 0x01020304;
+    constexpr uint32_t container_words = PlateInventory::container_size / 64;
+    constexpr uint32_t container_mask = PlateInventory::container_size - 1;
+    //  Positions of the last container of a region, the rest of its bits are never set
+    constexpr uint32_t last_container_size = Mark::marks_in_region - (PlateInventory::containers_per_region - 1) * PlateInventory::container_size;
+
+    //  Snapshot layout (native byte order, checked by Load):
+    //    InventoryHeader (64 bytes)
+    //    container_count containers in the order of regions and containers:
+    //      ContainerHeader, then cardinality uint16_t positions (array) or container_words uint64_t words (bitmap,
+    //      container_bitmap_flag is set in the index)
+    struct InventoryHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t container_size;
+        uint32_t container_count;
+        uint64_t issued;
+        std::uint8_t reserved[32];
+    };
+    static_assert(sizeof(InventoryHeader) == 64);
+    struct ContainerHeader {
+        uint16_t region;
+        uint16_t index;
+        uint32_t cardinality;
+    };
+    static_assert(sizeof(ContainerHeader) == 8);
+    constexpr uint16_t container_bitmap_flag = 0x8000;
+    static_assert(PlateInventory::containers_per_region <= container_bitmap_flag);
+
+    [[nodiscard]] constexpr uint64_t getLowMask(uint32_t bit) noexcept;
+    [[nodiscard]] constexpr uint64_t getRangeMask(uint32_t first, uint32_t last) noexcept;
+    [[nodiscard]] constexpr uint32_t getContainerSize(uint32_t index) noexcept;
+}
+
+// Bits from bit (including it) to 63
+[[nodiscard]] constexpr uint64_t RegMark::getLowMask(uint32_t bit) noexcept
+{
+    return ~uint64_t{0} << (bit % 64);
+}
+
+// Bits from first to last of one word, both are positions inside the word
+[[nodiscard]] constexpr uint64_t RegMark::getRangeMask(uint32_t first, uint32_t last) noexcept
+{
+    return getLowMask(first) & (~uint64_t{0} >> (63 - last % 64));
+}
+
+[[nodiscard]] constexpr uint32_t RegMark::getContainerSize(uint32_t index) noexcept
+{
+    return index + 1 == PlateInventory::containers_per_region ? last_container_size : PlateInventory::container_size;
+}
+
+static_assert(RegMark::getRangeMask(0, 63) == ~std::uint64_t{0} && RegMark::getRangeMask(4, 7) == 0xF0);
+static_assert(RegMark::last_container_size > 0 && RegMark::last_container_size <= RegMark::PlateInventory::container_size);
+
+[[nodiscard]] bool RegMark::PlateInventory::contains(const Container &container, uint32_t low) noexcept
+{
+    if (container.IsBitmap())
+        return (container.words[low / 64] >> (low % 64)) & 1;
+    return std::binary_search(container.values.begin(), container.values.end(), static_cast<uint16_t>(low));
+}
+
+// The summary follows every change of a word
+void RegMark::PlateInventory::setWord(Container &container, uint32_t word, uint64_t value) noexcept
+{
+    container.words[word] = value;
+    const uint64_t bit = uint64_t{1} << (word % 64);
+    if (value == ~uint64_t{0})
+        container.full[word / 64] |= bit;
+    else
+        container.full[word / 64] &= ~bit;
+}
+
+void RegMark::PlateInventory::toBitmap(Container &container)
+{
+    container.words.assign(container_words, 0);
+    for (const uint16_t low : container.values)
+        container.words[low / 64] |= uint64_t{1} << (low % 64);
+    for (uint32_t word = 0; word < container_words; ++word)
+        setWord(container, word, container.words[word]);
+    container.values.clear();
+    container.values.shrink_to_fit();
+}
+
+void RegMark::PlateInventory::toArray(Container &container)
+{
+    container.values.clear();
+    container.values.reserve(container.cardinality);
+    for (uint32_t word = 0; word < container_words; ++word) {
+        for (uint64_t bits = container.words[word]; bits != 0; bits &= bits - 1)
+            container.values.push_back(static_cast<uint16_t>(word * 64 + std::countr_zero(bits)));
+    }
+    container.words.clear();
+    container.words.shrink_to_fit();
+    container.full = {};
+}
+
+// Arrays grow into bitmaps past array_container_limit positions, like roaring containers, and bitmaps
+// shrink back below array_container_shrink_limit
+bool RegMark::PlateInventory::insert(Container &container, uint32_t low)
+{
+    if (container.IsBitmap()) {
+        const uint64_t bit = uint64_t{1} << (low % 64);
+        if (container.words[low / 64] & bit)
+            return false;
+        setWord(container, low / 64, container.words[low / 64] | bit);
+        ++container.cardinality;
+        return true;
+    }
+    const auto position = std::lower_bound(container.values.begin(), container.values.end(), static_cast<uint16_t>(low));
+    if (position != container.values.end() && *position == low)
+        return false;
+    container.values.insert(position, static_cast<uint16_t>(low));
+    if (++container.cardinality > array_container_limit)
+        toBitmap(container);
+    return true;
+}
+
+bool RegMark::PlateInventory::erase(Container &container, uint32_t low)
+{
+    if (container.IsBitmap()) {
+        const uint64_t bit = uint64_t{1} << (low % 64);
+        if (!(container.words[low / 64] & bit))
+            return false;
+        setWord(container, low / 64, container.words[low / 64] & ~bit);
+        if (--container.cardinality < array_container_shrink_limit)
+            toArray(container);
+        return true;
+    }
+    const auto position = std::lower_bound(container.values.begin(), container.values.end(), static_cast<uint16_t>(low));
+    if (position == container.values.end() || *position != low)
+        return false;
+    container.values.erase(position);
+    if (--container.cardinality == 0)
+        container.values.shrink_to_fit();
+    return true;
+}
+
+// A bitmap is scanned a word at a time, full words are skipped through the summary.
+// In an array the issued positions after low form a run while values[i] - i stays the same,
+// so the end of the run is found by binary search
+[[nodiscard]] uint32_t RegMark::PlateInventory::findFree(const Container &container, uint32_t low, uint32_t limit) noexcept
+{
+    uint32_t found = container_size;
+    if (container.IsBitmap()) {
+        uint32_t word = low / 64;
+        uint64_t free = ~container.words[word] & getLowMask(low);
+        if (free == 0) {
+            word = container_words;
+            for (uint32_t summary = (low / 64 + 1) / 64; summary < container.full.size(); ++summary) {
+                uint64_t not_full = ~container.full[summary];
+                if (summary == (low / 64 + 1) / 64)
+                    not_full &= getLowMask(low / 64 + 1);
+                if (not_full != 0) {
+                    word = summary * 64 + static_cast<uint32_t>(std::countr_zero(not_full));
+                    break;
+                }
+            }
+            if (word == container_words)
+                return container_size;
+            free = ~container.words[word];
+        }
+        found = word * 64 + static_cast<uint32_t>(std::countr_zero(free));
+    } else {
+        const std::vector<uint16_t> &values = container.values;
+        size_t first = static_cast<size_t>(std::lower_bound(values.begin(), values.end(), static_cast<uint16_t>(low)) - values.begin());
+        if (first == values.size() || values[first] != low) {
+            found = low;
+        } else {
+            const size_t offset = low - first;
+            size_t last = values.size();
+            while (first < last) {
+                const size_t middle = first + (last - first) / 2;
+                if (values[middle] - middle == offset)
+                    first = middle + 1;
+                else
+                    last = middle;
+            }
+            found = static_cast<uint32_t>(offset + first);
+        }
+    }
+    return found <= limit ? found : container_size;
+}
+
+[[nodiscard]] uint32_t RegMark::PlateInventory::countIssued(const Container &container, uint32_t low, uint32_t limit) noexcept
+{
+    if (container.cardinality == 0)
+        return 0;
+    if (!container.IsBitmap()) {
+        const auto first = std::lower_bound(container.values.begin(), container.values.end(), static_cast<uint16_t>(low));
+        const auto last = std::upper_bound(first, container.values.end(), static_cast<uint16_t>(limit));
+        return static_cast<uint32_t>(last - first);
+    }
+    const uint32_t first_word = low / 64;
+    const uint32_t last_word = limit / 64;
+    if (first_word == last_word)
+        return static_cast<uint32_t>(std::popcount(container.words[first_word] & getRangeMask(low, limit)));
+    uint32_t count = static_cast<uint32_t>(std::popcount(container.words[first_word] & getLowMask(low)));
+    for (uint32_t word = first_word + 1; word < last_word; ++word)
+        count += static_cast<uint32_t>(std::popcount(container.words[word]));
+    return count + static_cast<uint32_t>(std::popcount(container.words[last_word] & getRangeMask(0, limit)));
+}
+
+[[nodiscard]] const RegMark::PlateInventory::Region *RegMark::PlateInventory::findRegion(uint32_t region) const noexcept
+{
+    return region < regions.size() ? regions[region].get() : nullptr;
+}
+
+// Regions are allocated on the first issued mark and freed with the last one
+bool RegMark::PlateInventory::Issue(Mark mark)
+{
+    if (mark.Region() >= regions.size())
+        return false;
+    std::unique_ptr<Region> &region = regions[mark.Region()];
+    if (!region)
+        region = std::make_unique<Region>();
+    if (!insert(region->containers[mark.Position() >> container_bits], mark.Position() & container_mask)) {
+        if (region->issued == 0)
+            region.reset();
+        return false;
+    }
+    ++region->issued;
+    ++issued;
+    return true;
+}
+
+bool RegMark::PlateInventory::Release(Mark mark)
+{
+    if (mark.Region() >= regions.size() || !regions[mark.Region()])
+        return false;
+    std::unique_ptr<Region> &region = regions[mark.Region()];
+    if (!erase(region->containers[mark.Position() >> container_bits], mark.Position() & container_mask))
+        return false;
+    --issued;
+    if (--region->issued == 0)
+        region.reset();
+    return true;
+}
+
+[[nodiscard]] bool RegMark::PlateInventory::IsIssued(Mark mark) const noexcept
+{
+    const Region *region = findRegion(mark.Region());
+    return region != nullptr && contains(region->containers[mark.Position() >> container_bits], mark.Position() & container_mask);
+}
+
+[[nodiscard]] std::optional<RegMark::Mark> RegMark::PlateInventory::NextFree(Mark after, Mark first, Mark last) const noexcept
+{
+    if (after >= last)
+        return std::nullopt;
+    return FirstFree(after < first ? first : Mark::FromValue(after.Value() + 1), last);
+}
+
+// Empty containers give the first position at once, full ones are skipped without looking inside
+[[nodiscard]] std::optional<RegMark::Mark> RegMark::PlateInventory::FirstFree(Mark first, Mark last) const noexcept
+{
+    if (first.Region() != last.Region() || first > last || first.Region() >= regions.size())
+        return std::nullopt;
+    const Region *region = findRegion(first.Region());
+    if (region == nullptr)
+        return first;
+    const uint32_t first_container = first.Position() >> container_bits;
+    const uint32_t last_container = last.Position() >> container_bits;
+    for (uint32_t index = first_container; index <= last_container; ++index) {
+        const Container &container = region->containers[index];
+        const uint32_t low = index == first_container ? first.Position() & container_mask : 0;
+        const uint32_t limit = index == last_container ? last.Position() & container_mask : container_mask;
+        if (container.cardinality == container_size)
+            continue;
+        const uint32_t found = container.cardinality == 0 ? low : findFree(container, low, limit);
+        if (found != container_size)
+            return Mark::FromValue(first.Value() - first.Position() + (index << container_bits) + found);
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::optional<RegMark::Mark> RegMark::PlateInventory::IssueNext(Mark after, Mark first, Mark last)
+{
+    const std::optional<Mark> mark = NextFree(after, first, last);
+    if (mark)
+        Issue(*mark);
+    return mark;
+}
+
+[[nodiscard]] std::string RegMark::PlateInventory::IssueNextMarkAfterRange(const std::string &prevMark, const std::string &rangeStart,
+                                                                           const std::string &rangeEnd)
+{
+    const std::optional<Mark> previous = Mark::Parse(prevMark);
+    const std::optional<Mark> first = Mark::Parse(rangeStart);
+    const std::optional<Mark> last = Mark::Parse(rangeEnd);
+    if (!previous || !first || !last)
+        return std::string(out_of_stock);
+    const std::optional<Mark> mark = IssueNext(*previous, *first, *last);
+    return mark ? mark->Format() : std::string(out_of_stock);
+}
+
+[[nodiscard]] uint32_t RegMark::PlateInventory::CountFree(Mark first, Mark last) const noexcept
+{
+    if (first.Region() != last.Region() || first > last || first.Region() >= regions.size())
+        return 0;
+    const uint32_t size = last.Position() - first.Position() + 1;
+    const Region *region = findRegion(first.Region());
+    if (region == nullptr)
+        return size;
+    const uint32_t first_container = first.Position() >> container_bits;
+    const uint32_t last_container = last.Position() >> container_bits;
+    uint32_t issued_in_range = 0;
+    for (uint32_t index = first_container; index <= last_container; ++index) {
+        const uint32_t low = index == first_container ? first.Position() & container_mask : 0;
+        const uint32_t limit = index == last_container ? last.Position() & container_mask : container_mask;
+        issued_in_range += countIssued(region->containers[index], low, limit);
+    }
+    return size - issued_in_range;
+}
+
+[[nodiscard]] uint32_t RegMark::PlateInventory::CountIssued(uint32_t region) const noexcept
+{
+    const Region *found = findRegion(region);
+    return found == nullptr ? 0 : found->issued;
+}
+
+[[nodiscard]] RegMark::PlateInventory::Stats RegMark::PlateInventory::GetStats() const noexcept
+{
+    Stats stats = {issued, 0, 0, 0};
+    for (const auto &region : regions) {
+        if (!region)
+            continue;
+        ++stats.regions;
+        for (const Container &container : region->containers) {
+            if (container.IsBitmap())
+                ++stats.bitmap_containers;
+            else if (container.cardinality != 0)
+                ++stats.array_containers;
+        }
+    }
+    return stats;
+}
+
+void RegMark::PlateInventory::Clear() noexcept
+{
+    for (auto &region : regions)
+        region.reset();
+    issued = 0;
+}
+
+[[nodiscard]] bool RegMark::PlateInventory::Save(const std::string &path) const
+{
+    InventoryHeader header = {};
+    std::memcpy(header.magic, inventory_magic, sizeof(header.magic));
+    header.version = inventory_version;
+    header.byte_order = inventory_byte_order_mark;
+    header.container_size = container_size;
+    header.issued = issued;
+    for (const auto &region : regions) {
+        for (size_t index = 0; region && index < containers_per_region; ++index)
+            header.container_count += region->containers[index].cardinality != 0;
+    }
+
+    const std::string temporary_path = path + ".tmp";
+    std::FILE *file = std::fopen(temporary_path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    for (uint32_t region = 0; region < regions.size() && written; ++region) {
+        for (uint32_t index = 0; regions[region] && index < containers_per_region && written; ++index) {
+            const Container &container = regions[region]->containers[index];
+            if (container.cardinality == 0)
+                continue;
+            const uint16_t flag = container.IsBitmap() ? container_bitmap_flag : 0;
+            const ContainerHeader container_header = {static_cast<uint16_t>(region), static_cast<uint16_t>(index | flag), container.cardinality};
+            written = std::fwrite(&container_header, sizeof(container_header), 1, file) == 1;
+            if (container.IsBitmap())
+                written = written && std::fwrite(container.words.data(), sizeof(uint64_t), container_words, file) == container_words;
+            else
+                written = written && std::fwrite(container.values.data(), sizeof(uint16_t), container.cardinality, file) == container.cardinality;
+        }
+    }
+    if (std::fclose(file) != 0 || !written) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+}
+
+// Everything is read into a new inventory first, so a malformed snapshot leaves this one as is.
+// Positions past the end of the region, duplicate containers, wrong counts and containers of the wrong kind
+// for their cardinality are rejected. Version 1 snapshots are still read
+[[nodiscard]] bool RegMark::PlateInventory::Load(const std::string &path)
+{
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    PlateInventory loaded;
+    InventoryHeader header = {};
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 && std::memcmp(header.magic, inventory_magic, sizeof(header.magic)) == 0
+        && (header.version == 1 || header.version == inventory_version) && header.byte_order == inventory_byte_order_mark && header.container_size == container_size;
+    for (uint32_t i = 0; valid && i < header.container_count; ++i) {
+        ContainerHeader container_header = {};
+        valid = std::fread(&container_header, sizeof(container_header), 1, file) == 1;
+        const bool bitmap = header.version == 1 ? container_header.cardinality > array_container_limit
+                                                : (container_header.index & container_bitmap_flag) != 0;
+        container_header.index &= static_cast<uint16_t>(~container_bitmap_flag);
+        valid = valid && container_header.region <= Mark::max_region && container_header.index < containers_per_region
+            && container_header.cardinality != 0 && container_header.cardinality <= getContainerSize(container_header.index)
+            && (bitmap ? container_header.cardinality >= array_container_shrink_limit : container_header.cardinality <= array_container_limit);
+        if (!valid)
+            break;
+        std::unique_ptr<Region> &region = loaded.regions[container_header.region];
+        if (!region)
+            region = std::make_unique<Region>();
+        Container &container = region->containers[container_header.index];
+        const uint32_t size = getContainerSize(container_header.index);
+        valid = container.cardinality == 0;
+        if (valid && bitmap) {
+            container.words.assign(container_words, 0);
+            valid = std::fread(container.words.data(), sizeof(uint64_t), container_words, file) == container_words;
+            uint32_t cardinality = 0;
+            for (uint32_t word = 0; valid && word < container_words; ++word) {
+                cardinality += static_cast<uint32_t>(std::popcount(container.words[word]));
+                if (word * 64 + 64 > size)
+                    valid = (container.words[word] & (word * 64 >= size ? ~uint64_t{0} : getLowMask(size))) == 0;
+                setWord(container, word, container.words[word]);
+            }
+            valid = valid && cardinality == container_header.cardinality;
+        } else if (valid) {
+            container.values.resize(container_header.cardinality);
+            valid = std::fread(container.values.data(), sizeof(uint16_t), container.values.size(), file) == container.values.size()
+                && std::adjacent_find(container.values.begin(), container.values.end(), std::greater_equal<uint16_t>()) == container.values.end()
+                && container.values.back() < size;
+        }
+        container.cardinality = container_header.cardinality;
+        region->issued += container.cardinality;
+        loaded.issued += container.cardinality;
+    }
+    valid = valid && loaded.issued == header.issued && std::fgetc(file) == EOF;
+    std::fclose(file);
+    if (!valid)
+        return false;
+    *this = std::move(loaded);
+    return true;
+}
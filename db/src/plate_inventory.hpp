@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "reg_mark.hpp"
+
+namespace RegMark {
+    //  Issued license plate numbers of every region. The positions of a region (Mark::Position) are kept in a
+    //  compressed bitmap split in the roaring way: the high 16 bits select a container, the low 16 bits are
+    //  stored in it. A container with up to array_container_limit positions is a sorted array, a fuller one
+    //  is a bitmap of 1024 words with a summary of the full words, so a nearly full series is skipped
+    //  a word (64 marks) or a summary word (4096 marks) at a time instead of mark by mark. A bitmap turns
+    //  back into an array only below array_container_shrink_limit positions.
+    //  Regions that have no issued marks take no memory. Not thread-safe: the callers must synchronize.
+    class PlateInventory {
+    public:
+        struct Stats {
+            std::uint64_t issued;
+            std::size_t regions;            // Regions with issued marks
+            std::size_t array_containers;
+            std::size_t bitmap_containers;
+        };
+
+        static constexpr std::uint32_t container_bits = 16;
+        static constexpr std::uint32_t container_size = 1u << container_bits;
+        static constexpr std::uint32_t containers_per_region = (Mark::marks_in_region + container_size - 1) / container_size;
+        //  Containers with more positions are bitmaps: 4096 positions of an array take as much memory as a bitmap
+        static constexpr std::uint32_t array_container_limit = 4096;
+        //  Bitmaps with fewer positions are arrays again. The gap keeps a container that is issued and released
+        //  around array_container_limit from being converted on every call
+        static constexpr std::uint32_t array_container_shrink_limit = 2048;
+        static_assert(array_container_shrink_limit <= array_container_limit);
+
+        PlateInventory() : regions(Mark::max_region + 1) {}
+        PlateInventory(PlateInventory &&) noexcept = default;
+        PlateInventory &operator=(PlateInventory &&) noexcept = default;
+
+        //  Marks the plate as issued, returns false if it is already issued
+        bool Issue(Mark mark);
+        //  Marks the plate as free again, returns false if it is not issued
+        bool Release(Mark mark);
+        [[nodiscard]] bool IsIssued(Mark mark) const noexcept;
+
+        //  Returns the first free mark after the given one (not including it) from first to last (including
+        //  both boundaries), the range has the same meaning as in GetNextMarkAfterRange. Nothing is returned if
+        //  the marks are in different regions, first is after last or every mark of the range is issued
+        [[nodiscard]] std::optional<Mark> NextFree(Mark after, Mark first, Mark last) const noexcept;
+        //  Same as NextFree, but the search starts at first (including it)
+        [[nodiscard]] std::optional<Mark> FirstFree(Mark first, Mark last) const noexcept;
+        //  Finds the mark like NextFree and issues it
+        [[nodiscard]] std::optional<Mark> IssueNext(Mark after, Mark first, Mark last);
+        //  IssueNext for the formatted marks, the replacement of GetNextMarkAfterRange that skips the issued marks.
+        //  Returns "Out of stock" if any mark is invalid or the range has no free mark after prevMark
+        [[nodiscard]] std::string IssueNextMarkAfterRange(const std::string &prevMark, const std::string &rangeStart,
+                                                          const std::string &rangeEnd);
+        //  Number of free marks from first to last (including both boundaries), 0 if the range is invalid
+        [[nodiscard]] std::uint32_t CountFree(Mark first, Mark last) const noexcept;
+        [[nodiscard]] std::uint32_t CountIssued(std::uint32_t region) const noexcept;
+        [[nodiscard]] Stats GetStats() const noexcept;
+        void Clear() noexcept;
+
+        //  Writes the inventory to a temporary file and renames it to path, so the snapshot is never
+        //  partially written. Returns false if the file can't be written
+        [[nodiscard]] bool Save(const std::string &path) const;
+        //  Replaces the inventory with the snapshot. Returns false and keeps the inventory as is if the file
+        //  can't be read or is malformed
+        [[nodiscard]] bool Load(const std::string &path);
+    private:
+        //  Sorted array of the low bits (up to array_container_limit) or a bitmap (at least
+        //  array_container_shrink_limit), the summary bit w is set when word w of the bitmap is full
+        struct Container {
+            std::uint32_t cardinality = 0;
+            std::vector<std::uint16_t> values;
+            std::vector<std::uint64_t> words;
+            std::array<std::uint64_t, container_size / 64 / 64> full = {};
+
+            [[nodiscard]] bool IsBitmap() const noexcept { return !words.empty(); }
+        };
+        struct Region {
+            std::array<Container, containers_per_region> containers;
+            std::uint32_t issued = 0;
+        };
+
+        [[nodiscard]] static bool contains(const Container &container, std::uint32_t low) noexcept;
+        static bool insert(Container &container, std::uint32_t low);
+        static bool erase(Container &container, std::uint32_t low);
+        static void toBitmap(Container &container);
+        static void toArray(Container &container);
+        static void setWord(Container &container, std::uint32_t word, std::uint64_t value) noexcept;
+        //  First free low position from low to limit (including both) or container_size
+        [[nodiscard]] static std::uint32_t findFree(const Container &container, std::uint32_t low, std::uint32_t limit) noexcept;
+        [[nodiscard]] static std::uint32_t countIssued(const Container &container, std::uint32_t low, std::uint32_t limit) noexcept;
+        [[nodiscard]] const Region *findRegion(std::uint32_t region) const noexcept;
+
+        std::vector<std::unique_ptr<Region>> regions;
+        std::uint64_t issued = 0;
+    };
+}
@@ -1,7 +1,26 @@
 #pragma once
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
+#include "mark_core.hpp"
 
+//  Not installed: the functions defined in reg_mark.cpp are hidden in the shared library
 namespace RegMark {
+    //  Returned by GetNextMarkAfterRange when the range is exhausted
+    inline constexpr std::string_view out_of_stock = "Out of stock";
+    //  Checks the license plate number like CheckMark, but without any output and allocations.
+    //  Both a999aa999 and a999aa99 (two digit region) are accepted, see plate_format.hpp. Number 000 is
+    //  never issued and is reported as INVALID_DIGITS.
+    //  Returns the reason why the license plate number is incorrect or MarkError::NONE
+    [[nodiscard]] MarkError ValidateMark(std::string_view mark) noexcept;
+    //  Returns the text description of the error
+    [[nodiscard]] const char *GetErrorMessage(MarkError error) noexcept;
+    //  Returns the name of the error code ("INVALID_REGION") used in the output rows and the metrics
+    [[nodiscard]] std::string_view GetErrorName(MarkError error) noexcept;
     //  This function checks the passed license plate number in the format a999aa999 (in Latin caps letters) and 
     //  returns true or false depending on the correctness of the license plate number.
     [[nodiscard]] bool CheckMark(const std::string &mark);
@@ -11,7 +30,104 @@ namespace RegMark {
     //  This function accepts a license plate number in the format a999aa999 (in Latin caps letters) and 
     //  outputs the next number in the given number rangeStart to rangeEnd (including both boundaries). 
     //  If there is no possibility to output the next number, the "out of stock" message returned.
+    //  Marks are ordered by region, then by series (as GetNextMarkAfter goes), then by number.
     [[nodiscard]] std::string GetNextMarkAfterRange(const std::string &prevMark, const std::string &rangeMark, const std::string &rangeEnd);
-    //  Not implemented:
-    //    [[nodiscard]] int GetCombinationCountInRange(const std::string &firstMark, const std::string &secondMark);
+    //  This function accepts two license plate numbers in the format a999aa999 (in Latin caps letters) and
+    //  returns the number of marks between them (including both boundaries) in O(1).
+    //  If any mark is invalid or the regions are different, 0 is returned.
+    [[nodiscard]] int GetCombinationCountInRange(const std::string &firstMark, const std::string &secondMark);
+
+    //  License plate number a999aa999 packed into one integer. The region is the most significant part,
+    //  then the series (letters 1, 5 and 6, the first letter is the most significant) and the number.
+    //  Strings are parsed and formatted only at the boundaries, the rest is integer arithmetic.
+    //  Next, Previous and Add stay in the same region: after Y999YY goes A001AA of the same region.
+    class Mark {
+    public:
+        //  Legal series letters are latin letters that look like cyrillic ones: ABCEHKMOPTXY
+        static constexpr std::uint32_t series_letters = 12;
+        static constexpr std::uint32_t series_count = series_letters * series_letters * series_letters;
+        static constexpr std::uint32_t max_number = 999;
+        static constexpr std::uint32_t max_region = 999;
+        static constexpr std::uint32_t marks_in_region = series_count * max_number;
+
+        constexpr Mark() noexcept = default;
+        //  Series index is 0..series_count-1, number is 1..999, region is 1..999
+        [[nodiscard]] static constexpr Mark FromParts(std::uint32_t region, std::uint32_t series, std::uint32_t number) noexcept
+        {
+            return Mark(region * marks_in_region + series * max_number + number - 1);
+        }
+        [[nodiscard]] static constexpr Mark FromValue(std::uint32_t value) noexcept { return Mark(value); }
+        //  Returns nothing if the mark is not valid (see ValidateMark, the error is not counted by the metrics),
+        //  a999aa05 is the same mark as a999aa050
+        [[nodiscard]] static std::optional<Mark> Parse(std::string_view mark) noexcept;
+
+        //  Writes 9 symbols of the mark without allocations, one and two digit regions as 0d0 and dd0
+        void FormatTo(char *out) const noexcept;
+        [[nodiscard]] std::string Format() const;
+
+        [[nodiscard]] constexpr std::uint32_t Value() const noexcept { return value; }
+        [[nodiscard]] constexpr std::uint32_t Region() const noexcept { return value / marks_in_region; }
+        //  Position of the mark inside its region: series * 999 + number - 1
+        [[nodiscard]] constexpr std::uint32_t Position() const noexcept { return value % marks_in_region; }
+        [[nodiscard]] constexpr std::uint32_t Series() const noexcept { return Position() / max_number; }
+        [[nodiscard]] constexpr std::uint32_t Number() const noexcept { return Position() % max_number + 1; }
+
+        [[nodiscard]] constexpr Mark Next() const noexcept
+        {
+            return Position() == marks_in_region - 1 ? Mark(value - Position()) : Mark(value + 1);
+        }
+        [[nodiscard]] constexpr Mark Previous() const noexcept
+        {
+            return Position() == 0 ? Mark(value + marks_in_region - 1) : Mark(value - 1);
+        }
+        [[nodiscard]] constexpr Mark Add(std::int64_t count) const noexcept
+        {
+            std::int64_t position = (static_cast<std::int64_t>(Position()) + count) % marks_in_region;
+            if (position < 0)
+                position += marks_in_region;
+            return Mark(value - Position() + static_cast<std::uint32_t>(position));
+        }
+        //  Number of steps from other to this mark, regions are not taken into account
+        [[nodiscard]] constexpr std::int64_t Difference(Mark other) const noexcept
+        {
+            return static_cast<std::int64_t>(Position()) - static_cast<std::int64_t>(other.Position());
+        }
+
+        //  Total order of the packed values: region, then series, then number.
+        //  It is a single integer comparison, so marks can be sorted and binary searched directly
+        [[nodiscard]] constexpr bool operator==(const Mark &other) const noexcept = default;
+        [[nodiscard]] constexpr std::strong_ordering operator<=>(const Mark &other) const noexcept = default;
+    private:
+        constexpr explicit Mark(std::uint32_t value) noexcept : value(value) {}
+
+        std::uint32_t value = 0;
+    };
+    static_assert(Mark::marks_in_region == marks_in_region);
+
+    //  Same as GetCombinationCountInRange for already parsed marks
+    [[nodiscard]] constexpr int GetCombinationCountInRange(Mark firstMark, Mark secondMark) noexcept
+    {
+        if (firstMark.Region() != secondMark.Region())
+            return 0;
+        const std::int64_t difference = secondMark.Difference(firstMark);
+        return static_cast<int>((difference < 0 ? -difference : difference) + 1);
+    }
+    //  Writes up to count consecutive marks from first to last (including both boundaries) to out.
+    //  The marks must be in the same region and first must not be after last.
+    //  Returns the iterator past the last written mark, no allocations are made
+    template <typename OutputIt>
+    OutputIt GenerateMarks(Mark first, Mark last, std::size_t count, OutputIt out)
+    {
+        if (first.Region() != last.Region() || first.Position() > last.Position())
+            return out;
+        const std::size_t available = last.Position() - first.Position() + 1;
+        if (count > available)
+            count = available;
+        for (std::uint32_t value = first.Value(); count > 0; --count, ++value)
+            *out++ = Mark::FromValue(value);
+        return out;
+    }
+    //  Same as GenerateMarks, but writes formatted marks as 9-byte records without separators.
+    //  Returns the number of written marks
+    std::size_t GenerateMarkStrings(Mark first, Mark last, std::size_t count, char *out) noexcept;
 }
@@ -0,0 +1,228 @@
+//Columnar binary registry: streaming writer and memory-mapped reader
+#include "registry.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using size_t = std::size_t;
+using uint8_t = std::uint8_t;
+using uint16_t = std::uint16_t;
+using uint32_t = std::uint32_t;
+using uint64_t = std::uint64_t;
+
+namespace Registry {
+    const char magic[8] = {'V', 'I', 'N', 'R', 'E', 'G', '\0', '\1'};
+    const uint32_t version = 1;
+    const uint32_t byte_order_mark = 0x01020304;
+    const size_t column_alignment = 64;
+    const size_t vin_size = 17;
+
+    // Offsets of the columns inside a row group
+    struct GroupLayout {
+        size_t keys;
+        size_t countries;
+        size_t model_years;
+        size_t errors;
+        size_t size;
+    };
+
+    [[nodiscard]] constexpr size_t alignColumn(size_t size) noexcept;
+    [[nodiscard]] constexpr GroupLayout getGroupLayout(RecordKind kind, size_t rows) noexcept;
+}
+
+[[nodiscard]] constexpr size_t Registry::alignColumn(size_t size) noexcept
+{
+    return (size + column_alignment - 1) / column_alignment * column_alignment;
+}
+
+[[nodiscard]] constexpr Registry::GroupLayout Registry::getGroupLayout(RecordKind kind, size_t rows) noexcept
+{
+    GroupLayout layout = {};
+    if (kind == RecordKind::VIN) {
+        layout.countries = alignColumn(rows * vin_size);
+        layout.model_years = layout.countries + alignColumn(rows * sizeof(VIN::CountryId));
+        layout.errors = layout.model_years + alignColumn(rows * sizeof(uint16_t));
+    } else {
+        layout.errors = alignColumn(rows * sizeof(uint32_t));
+    }
+    layout.size = layout.errors + alignColumn(rows * sizeof(uint8_t));
+    return layout;
+}
+
+Registry::Writer::Writer(const std::string &path, RecordKind kind, uint32_t rows_per_group)
+    : kind(kind), rows_per_group(rows_per_group == 0 ? default_rows_per_group : rows_per_group)
+{
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return;
+    group.assign(getGroupLayout(kind, this->rows_per_group).size, 0);
+    // Placeholder, the real header is written by Close
+    const FileHeader header = {};
+    write_failed = std::fwrite(&header, sizeof(header), 1, file) != 1;
+}
+
+Registry::Writer::~Writer()
+{
+    if (file != nullptr)
+        (void)Close();
+}
+
+void Registry::Writer::AddVIN(std::string_view vin)
+{
+    AddDecodedVIN(vin, VIN::decode(vin));
+}
+
+void Registry::Writer::AddDecodedVIN(std::string_view vin, const VIN::DecodedVIN &decoded)
+{
+    if (file == nullptr || kind != RecordKind::VIN)
+        return;
+    const GroupLayout layout = getGroupLayout(kind, rows_per_group);
+    char *key = group.data() + layout.keys + group_rows * vin_size;
+    if (vin.size() == vin_size)
+        std::memcpy(key, vin.data(), vin_size);
+    else
+        std::memset(key, ' ', vin_size);
+    group[layout.countries + group_rows] = static_cast<char>(decoded.country);
+    std::memcpy(group.data() + layout.model_years + group_rows * sizeof(uint16_t), &decoded.model_year, sizeof(uint16_t));
+    group[layout.errors + group_rows] = static_cast<char>(decoded.error);
+    if (++group_rows == rows_per_group)
+        flushGroup();
+}
+
+void Registry::Writer::AddMark(std::string_view mark)
+{
+    if (file == nullptr || kind != RecordKind::MARK)
+        return;
+    const GroupLayout layout = getGroupLayout(kind, rows_per_group);
+    const RegMark::MarkError error = RegMark::ValidateMark(mark);
+    const std::optional<RegMark::Mark> parsed = RegMark::Mark::Parse(mark);
+    const uint32_t value = parsed ? parsed->Value() : invalid_mark;
+    std::memcpy(group.data() + layout.keys + group_rows * sizeof(uint32_t), &value, sizeof(uint32_t));
+    group[layout.errors + group_rows] = static_cast<char>(error);
+    if (++group_rows == rows_per_group)
+        flushGroup();
+}
+
+// Groups always have the full size, the unused rows of the last group stay zero
+void Registry::Writer::flushGroup()
+{
+    if (group_rows == 0)
+        return;
+    if (std::fwrite(group.data(), 1, group.size(), file) != group.size())
+        write_failed = true;
+    row_count += group_rows;
+    group_rows = 0;
+    std::fill(group.begin(), group.end(), 0);
+}
+
+[[nodiscard]] bool Registry::Writer::Close()
+{
+    if (file == nullptr)
+        return false;
+    flushGroup();
+    FileHeader header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = byte_order_mark;
+    header.kind = static_cast<uint32_t>(kind);
+    header.rows_per_group = rows_per_group;
+    header.row_count = row_count;
+    if (std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1)
+        write_failed = true;
+    if (std::fclose(file) != 0)
+        write_failed = true;
+    file = nullptr;
+    return !write_failed;
+}
+
+Registry::Reader::Reader(const std::string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        close(fd);
+        return;
+    }
+    void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return;
+
+    FileHeader header;
+    std::memcpy(&header, address, sizeof(header));
+    const bool known_kind = header.kind == static_cast<uint32_t>(RecordKind::VIN) || header.kind == static_cast<uint32_t>(RecordKind::MARK);
+    bool valid = std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == version
+              && header.byte_order == byte_order_mark && known_kind && header.rows_per_group != 0;
+    if (valid) {
+        // Divisions instead of the products, a corrupted row count can't overflow the check
+        const uint64_t groups = header.row_count / header.rows_per_group + (header.row_count % header.rows_per_group != 0);
+        const size_t group_size = getGroupLayout(static_cast<RecordKind>(header.kind), header.rows_per_group).size;
+        valid = groups <= (static_cast<uint64_t>(info.st_size) - sizeof(FileHeader)) / group_size;
+    }
+    if (!valid) {
+        munmap(address, info.st_size);
+        return;
+    }
+    data = static_cast<const char *>(address);
+    size = info.st_size;
+    kind = static_cast<RecordKind>(header.kind);
+    rows_per_group = header.rows_per_group;
+    row_count = header.row_count;
+}
+
+Registry::Reader::~Reader()
+{
+    if (data != nullptr)
+        munmap(const_cast<char *>(data), size);
+}
+
+[[nodiscard]] size_t Registry::Reader::GroupCount() const noexcept
+{
+    return rows_per_group == 0 ? 0 : (row_count + rows_per_group - 1) / rows_per_group;
+}
+
+[[nodiscard]] Registry::ColumnGroup Registry::Reader::Group(size_t index) const noexcept
+{
+    const GroupLayout layout = getGroupLayout(kind, rows_per_group);
+    const char *start = data + sizeof(FileHeader) + index * layout.size;
+    ColumnGroup group = {};
+    group.rows = index + 1 < GroupCount() ? rows_per_group : row_count - index * static_cast<uint64_t>(rows_per_group);
+    group.errors = reinterpret_cast<const uint8_t *>(start + layout.errors);
+    if (kind == RecordKind::VIN) {
+        group.vins = start + layout.keys;
+        group.countries = reinterpret_cast<const VIN::CountryId *>(start + layout.countries);
+        group.model_years = reinterpret_cast<const uint16_t *>(start + layout.model_years);
+    } else {
+        group.marks = reinterpret_cast<const uint32_t *>(start + layout.keys);
+    }
+    return group;
+}
+
+[[nodiscard]] std::string_view Registry::Reader::VINAt(uint64_t row) const noexcept
+{
+    return std::string_view(Group(row / rows_per_group).vins + row % rows_per_group * vin_size, vin_size);
+}
+
+[[nodiscard]] RegMark::Mark Registry::Reader::MarkAt(uint64_t row) const noexcept
+{
+    return RegMark::Mark::FromValue(Group(row / rows_per_group).marks[row % rows_per_group]);
+}
+
+[[nodiscard]] VIN::CountryId Registry::Reader::CountryAt(uint64_t row) const noexcept
+{
+    return Group(row / rows_per_group).countries[row % rows_per_group];
+}
+
+[[nodiscard]] uint16_t Registry::Reader::ModelYearAt(uint64_t row) const noexcept
+{
+    return Group(row / rows_per_group).model_years[row % rows_per_group];
+}
+
+[[nodiscard]] uint8_t Registry::Reader::ErrorAt(uint64_t row) const noexcept
+{
+    return Group(row / rows_per_group).errors[row % rows_per_group];
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "reg_mark.hpp"
+#include "vin.hpp"
+
+//  Columnar binary registry of decoded VIN numbers or license plate numbers.
+//  File layout (native byte order, checked when the file is opened):
+//    FileHeader (64 bytes)
+//    row groups of rows_per_group rows, every group has the same size, the last one is padded:
+//      key column       VIN: 17 symbols per row, mark: RegMark::Mark value (uint32_t) per row
+//      country column   uint8_t VIN::CountryId per row (VIN only)
+//      year column      uint16_t model year per row (VIN only)
+//      error column     uint8_t VINError / MarkError per row, 0 means valid
+//  Every column starts at a 64-byte boundary, so a memory-mapped file is scanned without any parsing.
+namespace Registry {
+    enum class RecordKind : std::uint32_t {
+        VIN = 1,
+        MARK = 2
+    };
+
+    struct FileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint32_t kind;
+        std::uint32_t rows_per_group;
+        std::uint64_t row_count;
+        std::uint8_t reserved[32];
+    };
+    static_assert(sizeof(FileHeader) == 64);
+
+    inline constexpr std::uint32_t default_rows_per_group = 1 << 16;
+    //  Key of a mark that can't be parsed
+    inline constexpr std::uint32_t invalid_mark = UINT32_MAX;
+
+    //  Pointers to the columns of one row group, columns that are not used by the kind are null
+    struct ColumnGroup {
+        const char *vins;               // 17 symbols per row, no separators
+        const std::uint32_t *marks;
+        const VIN::CountryId *countries;
+        const std::uint16_t *model_years;
+        const std::uint8_t *errors;
+        std::size_t rows;
+    };
+
+    //  Appends records one by one, only the current row group is kept in memory.
+    //  The header is completed by Close (or the destructor)
+    class Writer {
+    public:
+        Writer(const std::string &path, RecordKind kind, std::uint32_t rows_per_group = default_rows_per_group);
+        ~Writer();
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        [[nodiscard]] bool IsOpen() const noexcept { return file != nullptr; }
+        //  Decodes and appends the VIN number (VIN registry only), the wrong size VIN is stored as spaces
+        void AddVIN(std::string_view vin);
+        //  Appends already decoded VIN number (VIN registry only)
+        void AddDecodedVIN(std::string_view vin, const VIN::DecodedVIN &decoded);
+        //  Validates and appends the license plate number (mark registry only)
+        void AddMark(std::string_view mark);
+        //  Writes the last group and the header, returns false if anything failed to be written
+        [[nodiscard]] bool Close();
+        [[nodiscard]] std::uint64_t Size() const noexcept { return row_count + group_rows; }
+    private:
+        void flushGroup();
+
+        std::FILE *file = nullptr;
+        RecordKind kind;
+        std::uint32_t rows_per_group;
+        std::vector<char> group;
+        std::size_t group_rows = 0;
+        std::uint64_t row_count = 0;
+        bool write_failed = false;
+    };
+
+    //  Read-only memory-mapped registry, records are accessed in place
+    class Reader {
+    public:
+        //  Check IsOpen: the file may be missing or have a wrong header
+        explicit Reader(const std::string &path);
+        ~Reader();
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        [[nodiscard]] bool IsOpen() const noexcept { return data != nullptr; }
+        [[nodiscard]] RecordKind Kind() const noexcept { return kind; }
+        [[nodiscard]] std::uint64_t Size() const noexcept { return row_count; }
+        [[nodiscard]] std::uint32_t RowsPerGroup() const noexcept { return rows_per_group; }
+        [[nodiscard]] std::size_t GroupCount() const noexcept;
+        [[nodiscard]] ColumnGroup Group(std::size_t index) const noexcept;
+
+        [[nodiscard]] std::string_view VINAt(std::uint64_t row) const noexcept;
+        [[nodiscard]] RegMark::Mark MarkAt(std::uint64_t row) const noexcept;
+        [[nodiscard]] VIN::CountryId CountryAt(std::uint64_t row) const noexcept;
+        [[nodiscard]] std::uint16_t ModelYearAt(std::uint64_t row) const noexcept;
+        [[nodiscard]] std::uint8_t ErrorAt(std::uint64_t row) const noexcept;
+        [[nodiscard]] bool ValidAt(std::uint64_t row) const noexcept { return ErrorAt(row) == 0; }
+    private:
+        const char *data = nullptr;
+        std::size_t size = 0;
+        RecordKind kind = RecordKind::VIN;
+        std::uint32_t rows_per_group = 0;
+        std::uint64_t row_count = 0;
+    };
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace Batch {
+    //  Bounded lock-free queue for one producer thread and one consumer thread.
+    //  Capacity is rounded up to a power of two. TryPush moves the value only when it succeeds,
+    //  so a full queue leaves the value with the caller.
+    template <typename T>
+    class SPSCRing {
+    public:
+        explicit SPSCRing(std::size_t capacity)
+            : mask(std::bit_ceil(capacity < 2 ? 2 : capacity) - 1), slots(std::make_unique<T[]>(mask + 1)) {}
+        SPSCRing(const SPSCRing &) = delete;
+        SPSCRing &operator=(const SPSCRing &) = delete;
+
+        [[nodiscard]] bool TryPush(T &value)
+        {
+            const std::size_t position = tail.load(std::memory_order_relaxed);
+            if (position - head_cache > mask) {
+                head_cache = head.load(std::memory_order_acquire);
+                if (position - head_cache > mask)
+                    return false;
+            }
+            slots[position & mask] = std::move(value);
+            tail.store(position + 1, std::memory_order_release);
+            return true;
+        }
+        [[nodiscard]] bool TryPop(T &value)
+        {
+            const std::size_t position = head.load(std::memory_order_relaxed);
+            if (position == tail_cache) {
+                tail_cache = tail.load(std::memory_order_acquire);
+                if (position == tail_cache)
+                    return false;
+            }
+            value = std::move(slots[position & mask]);
+            head.store(position + 1, std::memory_order_release);
+            return true;
+        }
+        [[nodiscard]] std::size_t Capacity() const noexcept { return mask + 1; }
+    private:
+        const std::size_t mask;
+        const std::unique_ptr<T[]> slots;
+        // Every side caches the last seen position of the other one, so the shared line is read only
+        // when the queue looks full or empty
+        alignas(64) std::atomic<std::size_t> head{0};
+        std::size_t tail_cache = 0;
+        alignas(64) std::atomic<std::size_t> tail{0};
+        std::size_t head_cache = 0;
+    };
+
+    //  Bounded lock-free queue for any number of producers and consumers. Every slot has a sequence
+    //  number that tells whether it is free for the producer or filled for the consumer of the
+    //  current lap, so producers and consumers only compete for their own position counter.
+    template <typename T>
+    class MPMCRing {
+    public:
+        explicit MPMCRing(std::size_t capacity)
+            : mask(std::bit_ceil(capacity < 2 ? 2 : capacity) - 1), slots(std::make_unique<Slot[]>(mask + 1))
+        {
+            for (std::size_t i = 0; i <= mask; ++i)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        MPMCRing(const MPMCRing &) = delete;
+        MPMCRing &operator=(const MPMCRing &) = delete;
+
+        [[nodiscard]] bool TryPush(T &value)
+        {
+            std::size_t position = tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot &slot = slots[position & mask];
+                const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                const std::intptr_t difference = static_cast<std::intptr_t>(sequence - position);
+                if (difference == 0) {
+                    if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        slot.value = std::move(value);
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        [[nodiscard]] bool TryPop(T &value)
+        {
+            std::size_t position = head.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot &slot = slots[position & mask];
+                const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                const std::intptr_t difference = static_cast<std::intptr_t>(sequence - (position + 1));
+                if (difference == 0) {
+                    if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        value = std::move(slot.value);
+                        slot.sequence.store(position + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        [[nodiscard]] std::size_t Capacity() const noexcept { return mask + 1; }
+    private:
+        struct alignas(64) Slot {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        const std::size_t mask;
+        const std::unique_ptr<Slot[]> slots;
+        alignas(64) std::atomic<std::size_t> head{0};
+        alignas(64) std::atomic<std::size_t> tail{0};
+    };
+}
@@ -1,4 +1,23 @@
+set(db_library_source
+    src/vin.cpp
+    src/vin_batch.cpp
+    src/reg_mark.cpp
+    src/mark_allocator.cpp
+    src/plate_inventory.cpp
+    src/thread_pool.cpp
+    src/stream_processor.cpp
+    src/pipeline.cpp
+    src/registry.cpp
+    src/index.cpp
+    src/metrics.cpp
+    src/vin_cache.cpp
+    src/vin_analyzer.cpp)
+# Header-only core and the C interface, installed with the libraries
+set(db_public_headers
+    src/vin_analyzer.h
+    src/vin_core.hpp
+    src/mark_core.hpp
+    src/plate_format.hpp)
 set(db_source
     src/main.cpp
-    src/vin.cpp
-    src/reg_mark.cpp)
+    ${db_library_source})
@@ -0,0 +1,325 @@
+//Streaming validation of large VIN and license plate files.
+//The input is split into chunks at line boundaries, every chunk is turned into output rows by the
+//thread pool and the rows are written in the input order while the next chunks are processed.
+#include "stream_processor.hpp"
+#include <cerrno>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "plate_format.hpp"
+#include "reg_mark.hpp"
+#include "thread_pool.hpp"
+#include "vin.hpp"
+#include "vin_cache.hpp"
+
+using string = std::string;
+using size_t = std::size_t;
+
+namespace Batch {
+    const char *vin_header[] = {"vin", "valid", "error", "country", "year", "corrections"};
+    const char *mark_header[] = {"mark", "valid", "error", "region"};
+    const size_t row_size_estimate = 48;
+
+    // Chunk of input, data points either into the mapped file or into storage
+    struct Chunk {
+        std::string_view data;
+        std::vector<char> storage;
+    };
+    struct ChunkResult {
+        string rows;
+        long long lines = 0;
+    };
+
+    class ChunkReader {
+    public:
+        explicit ChunkReader(int fd, size_t chunk_size);
+        ~ChunkReader();
+        [[nodiscard]] bool failed() const noexcept { return read_failed; }
+        // Returns false when the input is over
+        [[nodiscard]] bool next(Chunk &chunk);
+    private:
+        int fd;
+        size_t chunk_size;
+        bool read_failed = false;
+        // Memory-mapped regular file
+        const char *mapped = nullptr;
+        size_t mapped_size = 0;
+        size_t mapped_position = 0;
+        // Unfinished line of the previous block for other inputs
+        std::vector<char> carry;
+        bool input_over = false;
+    };
+
+    void appendField(string &row, std::string_view field, OutputFormat format);
+    void appendColumns(string &out, const char *const *columns, size_t count, OutputFormat format);
+    [[nodiscard]] ChunkResult processChunk(std::string_view data, const Options &options, VIN::DecodeCache *cache);
+}
+
+Batch::ChunkReader::ChunkReader(int fd, size_t chunk_size)
+    : fd(fd), chunk_size(chunk_size == 0 ? 1 : chunk_size)
+{
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            madvise(address, info.st_size, MADV_SEQUENTIAL);
+            mapped = static_cast<const char *>(address);
+            mapped_size = info.st_size;
+        }
+    }
+}
+
+Batch::ChunkReader::~ChunkReader()
+{
+    if (mapped != nullptr)
+        munmap(const_cast<char *>(mapped), mapped_size);
+}
+
+[[nodiscard]] bool Batch::ChunkReader::next(Chunk &chunk)
+{
+    chunk.storage.clear();
+    if (mapped != nullptr) {
+        if (mapped_position == mapped_size)
+            return false;
+        // Extend the chunk to the end of the line
+        size_t end = mapped_position + chunk_size;
+        if (end >= mapped_size) {
+            end = mapped_size;
+        } else {
+            while (end < mapped_size && mapped[end - 1] != '\n')
+                ++end;
+        }
+        chunk.data = std::string_view(mapped + mapped_position, end - mapped_position);
+        mapped_position = end;
+        return true;
+    }
+
+    if (input_over)
+        return false;
+    chunk.storage.swap(carry);
+    carry.clear();
+    const size_t start = chunk.storage.size();
+    chunk.storage.resize(start + chunk_size);
+    size_t filled = start;
+    while (filled < chunk.storage.size()) {
+        const ssize_t count = read(fd, chunk.storage.data() + filled, chunk.storage.size() - filled);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            read_failed = true;
+            input_over = true;
+            break;
+        }
+        if (count == 0) {
+            input_over = true;
+            break;
+        }
+        filled += count;
+    }
+    chunk.storage.resize(filled);
+    // Everything after the last newline goes to the next chunk, a line longer than the block
+    // gives an empty chunk and keeps growing in carry
+    if (!input_over) {
+        size_t line_end = filled;
+        while (line_end > 0 && chunk.storage[line_end - 1] != '\n')
+            --line_end;
+        carry.assign(chunk.storage.begin() + line_end, chunk.storage.end());
+        chunk.storage.resize(line_end);
+    }
+    chunk.data = std::string_view(chunk.storage.data(), chunk.storage.size());
+    return !chunk.data.empty() || !input_over;
+}
+
+// CSV fields are quoted only when needed, TSV fields can't contain tabs, so they are replaced
+void Batch::appendField(string &row, std::string_view field, OutputFormat format)
+{
+    if (format == OutputFormat::TSV) {
+        for (const auto symbol : field)
+            row += symbol == '\t' ? ' ' : symbol;
+        return;
+    }
+    if (field.find_first_of(",\"") == std::string_view::npos) {
+        row += field;
+        return;
+    }
+    row += '"';
+    for (const auto symbol : field) {
+        if (symbol == '"')
+            row += '"';
+        row += symbol;
+    }
+    row += '"';
+}
+
+void Batch::appendColumns(string &out, const char *const *columns, size_t count, OutputFormat format)
+{
+    const char separator = format == OutputFormat::CSV ? ',' : '\t';
+    for (size_t i = 0; i < count; ++i) {
+        if (i != 0)
+            out += separator;
+        out += columns[i];
+    }
+    out += '\n';
+}
+
+// The corrections column is the last one of vin_header
+void Batch::appendHeader(string &out, InputKind kind, OutputFormat format, bool corrections)
+{
+    if (kind == InputKind::VIN)
+        appendColumns(out, vin_header, std::size(vin_header) - !corrections, format);
+    else
+        appendColumns(out, mark_header, std::size(mark_header), format);
+}
+
+void Batch::appendVINRow(string &out, std::string_view vin, const VIN::DecodedVIN &decoded, OutputFormat format,
+                         bool corrections)
+{
+    const char separator = format == OutputFormat::CSV ? ',' : '\t';
+    appendField(out, vin, format);
+    out += separator;
+    out += decoded.valid() ? '1' : '0';
+    out += separator;
+    out += VIN::getErrorName(decoded.error);
+    out += separator;
+    appendField(out, VIN::getCountryName(decoded.country), format);
+    out += separator;
+    if (decoded.model_year != 0) {
+        char number[16];
+        out.append(number, std::snprintf(number, sizeof(number), "%u", decoded.model_year));
+    }
+    if (corrections) {
+        out += separator;
+        const VIN::VINCorrections found = decoded.valid() ? VIN::VINCorrections{} : VIN::findCorrections(vin);
+        for (size_t i = 0; i < found.count; ++i) {
+            char item[8];
+            if (i != 0)
+                out += ' ';
+            out.append(item, std::snprintf(item, sizeof(item), "%u:%c", found.items[i].position + 1u, found.items[i].symbol));
+        }
+    }
+    out += '\n';
+}
+
+void Batch::appendMarkRow(string &out, std::string_view mark, RegMark::MarkError error, unsigned int region, OutputFormat format)
+{
+    const char separator = format == OutputFormat::CSV ? ',' : '\t';
+    appendField(out, mark, format);
+    out += separator;
+    out += error == RegMark::MarkError::NONE ? '1' : '0';
+    out += separator;
+    out += RegMark::GetErrorName(error);
+    out += separator;
+    if (region != 0) {
+        char number[16];
+        out.append(number, std::snprintf(number, sizeof(number), "%u", region));
+    }
+    out += '\n';
+}
+
+[[nodiscard]] Batch::ChunkResult Batch::processChunk(std::string_view data, const Options &options, VIN::DecodeCache *cache)
+{
+    const InputKind kind = options.kind;
+    const OutputFormat format = options.format;
+    // Normalized VIN numbers are copied, the buffer keeps its capacity between the lines
+    string normalized;
+    ChunkResult result;
+    string &out = result.rows;
+    out.reserve(data.size() + data.size() / 17 * row_size_estimate);
+    while (!data.empty()) {
+        size_t line_end = data.find('\n');
+        std::string_view line = data.substr(0, line_end);
+        data.remove_prefix(line_end == std::string_view::npos ? data.size() : line_end + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        ++result.lines;
+
+        if (kind == InputKind::VIN) {
+            if (options.normalize) {
+                normalized.assign(line);
+                VIN::normalizeVIN(normalized);
+                line = normalized;
+            }
+            appendVINRow(out, line, decodeValidatedVIN(line, VIN::validateVIN(line), cache), format, options.corrections);
+        } else {
+            const RegMark::MarkError error = RegMark::ValidateMark(line);
+            appendMarkRow(out, line, error, error == RegMark::MarkError::NONE ? getMarkRegion(line) : 0, format);
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] VIN::DecodedVIN Batch::decodeValidatedVIN(std::string_view vin, VIN::VINError error, VIN::DecodeCache *cache) noexcept
+{
+    VIN::DecodedVIN decoded = {};
+    decoded.error = error;
+    if (error == VIN::VINError::INVALID_SIZE)
+        return decoded;
+    if (cache != nullptr)
+        return cache->Decode(vin);
+    decoded.country = VIN::getVINCountryId(vin);
+    decoded.model_year = static_cast<std::uint16_t>(VIN::getModelYear(vin));
+    return decoded;
+}
+
+[[nodiscard]] unsigned int Batch::getMarkRegion(std::string_view mark) noexcept
+{
+    const RegMark::PlateParts parts = mark.size() == RegMark::PrivateFormat::size ? RegMark::PrivateFormat::GetParts(mark)
+                                                                                  : RegMark::PrivateShortFormat::GetParts(mark);
+    return parts.region;
+}
+
+[[nodiscard]] std::string_view Batch::getErrorCodeName(InputKind kind, int error) noexcept
+{
+    if (error < 0)
+        return "UNKNOWN";
+    if (kind == InputKind::VIN)
+        return error <= static_cast<int>(VIN::VINError::INVALID_CHECKSUM) ? VIN::getErrorName(static_cast<VIN::VINError>(error)) : "UNKNOWN";
+    return RegMark::GetErrorName(static_cast<RegMark::MarkError>(error));
+}
+
+long long Batch::processStream(int input_fd, std::FILE *output, const Options &options)
+{
+    ThreadPool pool(options.threads);
+    const size_t max_in_flight = options.max_chunks_in_flight != 0 ? options.max_chunks_in_flight : pool.Size() * 2;
+
+    string header;
+    appendHeader(header, options.kind, options.format, options.corrections);
+    std::fwrite(header.data(), 1, header.size(), output);
+
+    // Futures are kept in the input order, the oldest one is written first
+    long long lines = 0;
+    std::deque<std::future<ChunkResult>> in_flight;
+    const auto write_oldest = [&] {
+        const ChunkResult result = in_flight.front().get();
+        in_flight.pop_front();
+        std::fwrite(result.rows.data(), 1, result.rows.size(), output);
+        lines += result.lines;
+    };
+
+    // Shared by all workers, the cache is locked by shards
+    std::unique_ptr<VIN::DecodeCache> cache;
+    if (options.kind == InputKind::VIN && options.cache_capacity != 0)
+        cache = std::make_unique<VIN::DecodeCache>(options.cache_capacity);
+    ChunkReader reader(input_fd, options.chunk_size);
+    Chunk chunk;
+    while (reader.next(chunk)) {
+        if (chunk.data.empty())
+            continue;
+        if (in_flight.size() >= max_in_flight)
+            write_oldest();
+        auto shared_chunk = std::make_shared<Chunk>(std::move(chunk));
+        chunk = Chunk();
+        in_flight.push_back(pool.Submit([shared_chunk, &options, shared_cache = cache.get()] {
+            return processChunk(shared_chunk->data, options, shared_cache);
+        }));
+    }
+    while (!in_flight.empty())
+        write_oldest();
+    std::fflush(output);
+    return reader.failed() ? -1 : lines;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "reg_mark.hpp"
+#include "vin.hpp"
+
+namespace VIN {
+    class DecodeCache;
+}
+
+namespace Batch {
+    enum class InputKind {
+        VIN,
+        MARK
+    };
+    enum class OutputFormat {
+        CSV,
+        TSV
+    };
+    struct Options {
+        InputKind kind = InputKind::VIN;
+        OutputFormat format = OutputFormat::CSV;
+        std::size_t threads = 0;                // 0 means all hardware threads
+        std::size_t chunk_size = 4 << 20;       // Bytes of input processed by one task
+        std::size_t max_chunks_in_flight = 0;   // 0 means two chunks per thread
+        std::size_t cache_capacity = 0;         // Decoded VIN numbers kept in VIN::DecodeCache, 0 disables it
+        bool normalize = false;                 // VIN numbers go through VIN::normalizeVIN first
+        bool corrections = false;               // VIN rows get the column of VIN::findCorrections
+    };
+
+    //  Reads newline-delimited VIN numbers or license plate numbers from input_fd and writes one row
+    //  per line to output: the input value, validity, error code and, for VIN, country and model year.
+    //  Regular files are memory-mapped, other inputs (pipes, terminals) are read in large blocks.
+    //  Chunks are processed in parallel, but rows keep the input order and at most
+    //  max_chunks_in_flight chunks are held in memory. Returns the number of processed lines
+    //  or -1 if the input can't be read
+    long long processStream(int input_fd, std::FILE *output, const Options &options);
+    //  Returns the name of the error code used in the output
+    [[nodiscard]] std::string_view getErrorCodeName(InputKind kind, int error) noexcept;
+    //  Output rows, shared by processStream and the pipeline. Only the error, country and model year
+    //  of decoded are written, region 0 leaves the region column empty. With corrections the VIN rows
+    //  get one more column: the single-symbol corrections of an invalid VIN as "position:symbol"
+    //  (1-based position) separated by spaces
+    void appendHeader(std::string &out, InputKind kind, OutputFormat format, bool corrections = false);
+    void appendVINRow(std::string &out, std::string_view vin, const VIN::DecodedVIN &decoded, OutputFormat format,
+                      bool corrections = false);
+    void appendMarkRow(std::string &out, std::string_view mark, RegMark::MarkError error, unsigned int region, OutputFormat format);
+    //  Fields of the VIN row after validateVIN returned error: country and model year, taken from
+    //  the cache if there is one. The VIN is validated once, so the metrics count every row once
+    [[nodiscard]] VIN::DecodedVIN decodeValidatedVIN(std::string_view vin, VIN::VINError error, VIN::DecodeCache *cache) noexcept;
+    //  Region of a mark that passed ValidateMark
+    [[nodiscard]] unsigned int getMarkRegion(std::string_view mark) noexcept;
+}
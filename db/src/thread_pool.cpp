@@ -0,0 +1,78 @@
+//Work-stealing thread pool used by the batch tools
+#include "thread_pool.hpp"
+
+using size_t = std::size_t;
+
+Batch::ThreadPool::ThreadPool(size_t threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    for (size_t i = 0; i < threads; ++i)
+        workers.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < threads; ++i)
+        this->threads.emplace_back([this, i] { run(i); });
+}
+
+Batch::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &thread : threads)
+        thread.join();
+}
+
+void Batch::ThreadPool::push(std::function<void()> task)
+{
+    Worker &worker = *workers[next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+    {
+        // Counter is changed under the wait mutex, so a worker can't miss the wake up,
+        // and under the queue mutex, so it never goes below zero
+        std::lock_guard<std::mutex> wait_lock(wait_mutex);
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+        queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+// Own queue is used as a stack (the newest task is still hot in cache), other queues are robbed from the front
+[[nodiscard]] bool Batch::ThreadPool::tryTake(size_t index, std::function<void()> &task)
+{
+    for (size_t i = 0; i < workers.size(); ++i) {
+        Worker &worker = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty())
+            continue;
+        if (i == 0) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        } else {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void Batch::ThreadPool::run(size_t index)
+{
+    std::function<void()> task;
+    for (;;) {
+        if (tryTake(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_relaxed) > 0; });
+        if (stopping && queued.load(std::memory_order_relaxed) == 0)
+            return;
+    }
+}
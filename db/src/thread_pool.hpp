@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Batch {
+    //  Fixed-size pool of threads with work stealing. Every worker has its own queue: new tasks are
+    //  spread over the queues round-robin, a worker takes tasks from the back of its own queue and
+    //  steals from the front of the other queues when its own is empty.
+    class ThreadPool {
+    public:
+        //  0 threads means std::thread::hardware_concurrency()
+        explicit ThreadPool(std::size_t threads = 0);
+        //  Finishes all submitted tasks before returning
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        //  Runs the task on one of the workers, the result (or exception) is returned through the future
+        template <typename Task>
+        [[nodiscard]] std::future<std::invoke_result_t<Task>> Submit(Task task)
+        {
+            using Result = std::invoke_result_t<Task>;
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+            std::future<Result> result = packaged->get_future();
+            push([packaged] { (*packaged)(); });
+            return result;
+        }
+        [[nodiscard]] std::size_t Size() const noexcept { return workers.size(); }
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        void push(std::function<void()> task);
+        [[nodiscard]] bool tryTake(std::size_t index, std::function<void()> &task);
+        void run(std::size_t index);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+        std::atomic<std::size_t> next_worker{0};
+        std::atomic<std::size_t> queued{0};
+        std::mutex wait_mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+    };
+}
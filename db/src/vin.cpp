@@ -4,21 +4,23 @@
 
 #include <array>
 #include <iostream>
+#include <type_traits>
 #include "vin.hpp"
+#include "metrics.hpp"
 
 using string = std::string;
 using size_t = std::size_t;
 
 namespace VIN {
     struct Country {
-        const string code;
-        const string name;
+        const std::string_view code;
+        const std::string_view name;
 
-        Country(const string &code, const string &name)
+        constexpr Country(std::string_view code, std::string_view name)
             : code(code), name(name) {}
     };
-    const size_t countries = 89;
-    const std::array<const Country, countries> country_data = {
+    constexpr size_t countries = 89;
+    constexpr std::array<const Country, countries> country_data = {
         {
             Country("AA-AH", "UAR"), 
             Country("AJ-AN", "Cot D'Ivoire"),
@@ -111,163 +113,363 @@ namespace VIN {
             Country("93-99", "Brazil")
         }
     };
+    const std::string_view country_not_used = "Not used";
+
+    // Symbols of the ranges above go in the order A..Z, 1..9, 0
+    constexpr size_t wmi_symbols = 36;
+    [[nodiscard]] constexpr int getWMISymbolIndex(const char symbol) noexcept;
+    [[nodiscard]] constexpr CountryId getCountryDataId(const size_t entry) noexcept;
+    [[nodiscard]] constexpr bool checkCountryRanges() noexcept;
+    [[nodiscard]] constexpr std::array<CountryId, wmi_symbols * wmi_symbols> makeCountryTable() noexcept;
+    [[nodiscard]] constexpr bool checkCountryTable() noexcept;
 
-    const size_t vin_size = 17;
-    const char *illegal_chars = "IOQ";
     const char *vin_size_error = "Error! VIN number size is invalid!\n";
     const char *illegal_vin_number_ioq_symbols_error = "Error! Illegal VIN argument: VIN have I, O, Q symbols!\n"; 
     const char *illegal_vin_number_symbols_error = "Error! Illegal VIN argument: VIN have illegal symbols!\n";
     const char *illegal_vin_number_checksum_error = "Error! Checksum is not properly set in VIN number!\n";
     const char *checksum_error = "Error! Checksum is invalid!\n";  
+    const std::array<std::string_view, 6> error_names = {
+        "NONE", "INVALID_SIZE", "ILLEGAL_SYMBOLS", "ILLEGAL_IOQ_SYMBOLS", "INVALID_CHECK_DIGIT_SYMBOL", "INVALID_CHECKSUM"
+    };
 
-    [[nodiscard]] bool checkForIllegalCharacters(const string &vin);
+    [[nodiscard]] inline VINError findError(std::string_view vin) noexcept;
+    [[nodiscard]] VINError checkForIllegalCharacters(std::string_view vin) noexcept;
     namespace checkSum {
-        [[nodiscard]] inline int getCharId(const char sym);
-        [[nodiscard]] inline bool verifyCheckSum(const string &vin); 
-        [[nodiscard]] inline int getWeight(const size_t position);
+        [[nodiscard]] inline bool verifyCheckSum(std::string_view vin) noexcept;
+    }
+    namespace correction {
+        constexpr size_t checksum_modulo = 11;
+        constexpr size_t max_symbols_per_value = 4;
+        using ValueSymbols = std::array<std::array<char, max_symbols_per_value + 1>, checksum_modulo>;
+
+        [[nodiscard]] constexpr std::array<char, 256> makeNormalizedSymbols() noexcept;
+        [[nodiscard]] constexpr ValueSymbols makeValueSymbols() noexcept;
+        [[nodiscard]] constexpr std::array<std::uint8_t, checksum_modulo> makeInverses() noexcept;
+        inline void addCorrection(VINCorrections &corrections, size_t position, char symbol) noexcept;
     }
 };
 
 [[nodiscard]] bool VIN::checkVIN(const string &vin)
+{
+    const Metrics::ScopedTimer timer(Metrics::Function::CHECK_VIN);
+    const VINError error = validateVIN(vin);
+    if (error != VINError::NONE) {
+        std::cerr << getErrorMessage(error);
+        return false;
+    }
+    return true;
+}
+
+// Every result is counted as a validation with its error code
+[[nodiscard]] VIN::VINError VIN::validateVIN(std::string_view vin) noexcept
+{
+    const Metrics::ScopedTimer timer(Metrics::Function::VALIDATE_VIN);
+    const VINError error = findError(vin);
+    Metrics::recordVINError(error);
+    return error;
+}
+
+[[nodiscard]] inline VIN::VINError VIN::findError(std::string_view vin) noexcept
 {
     // Firstly check size of string
     if (vin.size() != vin_size)
-        return false;
+        return VINError::INVALID_SIZE;
     // Check correctness of VIN
-    if (!checkForIllegalCharacters(vin)) 
-        return false;
+    const VINError symbols_error = checkForIllegalCharacters(vin);
+    if (symbols_error != VINError::NONE)
+        return symbols_error;
     if (!checkSum::verifyCheckSum(vin))
-        return false;
+        return VINError::INVALID_CHECKSUM;
+    return VINError::NONE;
+}
+
+[[nodiscard]] const char *VIN::getErrorMessage(VINError error) noexcept
+{
+    switch (error) {
+    case VINError::INVALID_SIZE:
+        return vin_size_error;
+    case VINError::ILLEGAL_SYMBOLS:
+        return illegal_vin_number_symbols_error;
+    case VINError::ILLEGAL_IOQ_SYMBOLS:
+        return illegal_vin_number_ioq_symbols_error;
+    case VINError::INVALID_CHECK_DIGIT_SYMBOL:
+        return illegal_vin_number_checksum_error;
+    case VINError::INVALID_CHECKSUM:
+        return checksum_error;
+    default:
+        return "";
+    }
+}
+
+static_assert(VIN::error_names.size() == static_cast<std::size_t>(VIN::VINError::INVALID_CHECKSUM) + 1);
+
+[[nodiscard]] std::string_view VIN::getErrorName(VINError error) noexcept
+{
+    const auto index = static_cast<size_t>(error);
+    return index < error_names.size() ? error_names[index] : "UNKNOWN";
+}
+
+[[nodiscard]] constexpr int VIN::getWMISymbolIndex(const char symbol) noexcept
+{
+    if (symbol >= 'A' && symbol <= 'Z')
+        return symbol - 'A';
+    if (symbol >= '1' && symbol <= '9')
+        return symbol - '1' + 26;
+    if (symbol == '0')
+        return wmi_symbols - 1;
+    return -1;
+}
+
+// Country ID is the position of the first entry with the same name, so every name is stored once
+[[nodiscard]] constexpr VIN::CountryId VIN::getCountryDataId(const size_t entry) noexcept
+{
+    size_t first = 0;
+    while (country_data[first].name != country_data[entry].name)
+        ++first;
+    return static_cast<CountryId>(first + 1);
+}
+
+// Every range must look like "AA-AH" and stay within one region
+[[nodiscard]] constexpr bool VIN::checkCountryRanges() noexcept
+{
+    for (const auto &country : country_data) {
+        const std::string_view code = country.code;
+        if (code.size() != 5 || code[2] != '-' || code[0] != code[3])
+            return false;
+        const int first = getWMISymbolIndex(code[1]);
+        const int last = getWMISymbolIndex(code[4]);
+        if (getWMISymbolIndex(code[0]) < 0 || first < 0 || last < first)
+            return false;
+    }
     return true;
 }
+static_assert(VIN::checkCountryRanges(), "Country ranges are malformed");
 
-// This algorithm first checks the region code, 
-// if there is a match, the algorithm starts looking for the country code in that region
-[[nodiscard]] string VIN::getVINCountry(const string &vin)
+// Direct-index table for the first two VIN symbols. When ranges overlap the first one wins
+[[nodiscard]] constexpr std::array<VIN::CountryId, VIN::wmi_symbols * VIN::wmi_symbols> VIN::makeCountryTable() noexcept
 {
-    const char vin_region_code = vin[0];
-    const char vin_country_code = vin[1];
+    std::array<CountryId, wmi_symbols * wmi_symbols> table = {};
     for (size_t i = 0; i < countries; ++i) {
-        const char region_code = country_data[i].code[0];
-        // Is there match?
-        if (vin_region_code == region_code) {
-            const char min_country_code = country_data[i].code[1];
-            const char max_country_code = country_data[i].code[4];
-            // Handle case when max country code is digit 
-            if (std::isdigit(max_country_code)) {
-                if (std::isdigit(vin_country_code)) {
-                    if (max_country_code - '0' == 0)
-                        return country_data[i].name;
-                    if (vin_country_code <= max_country_code)
-                        return country_data[i].name;
-                } else 
-                    return country_data[i].name;
+        const std::string_view code = country_data[i].code;
+        const int region = getWMISymbolIndex(code[0]);
+        for (int symbol = getWMISymbolIndex(code[1]); symbol <= getWMISymbolIndex(code[4]); ++symbol) {
+            CountryId &id = table[region * wmi_symbols + symbol];
+            if (id == 0)
+                id = getCountryDataId(i);
+        }
+    }
+    return table;
+}
+
+namespace VIN {
+    constexpr std::array<CountryId, wmi_symbols * wmi_symbols> country_table = makeCountryTable();
+}
+
+// Every symbol pair that lies in a range must resolve to the first range containing it
+[[nodiscard]] constexpr bool VIN::checkCountryTable() noexcept
+{
+    for (int region = 0; region < static_cast<int>(wmi_symbols); ++region) {
+        for (int symbol = 0; symbol < static_cast<int>(wmi_symbols); ++symbol) {
+            CountryId expected = 0;
+            for (size_t i = 0; i < countries && expected == 0; ++i) {
+                const std::string_view code = country_data[i].code;
+                if (getWMISymbolIndex(code[0]) == region && getWMISymbolIndex(code[1]) <= symbol && symbol <= getWMISymbolIndex(code[4]))
+                    expected = getCountryDataId(i);
             }
-            if (vin_country_code >= min_country_code && vin_country_code <= max_country_code)
-                return country_data[i].name;
+            if (country_table[region * wmi_symbols + symbol] != expected)
+                return false;
         }
     }
-    [[unlikely]] return "Not used";
+    return true;
+}
+static_assert(VIN::checkCountryTable(), "Country table does not match country ranges");
+static_assert(VIN::country_data[VIN::country_table[VIN::getWMISymbolIndex('K') * VIN::wmi_symbols + VIN::getWMISymbolIndex('0')] - 1].name == "Kazakhstan");
+static_assert(VIN::country_data[VIN::country_table[VIN::getWMISymbolIndex('L') * VIN::wmi_symbols + VIN::getWMISymbolIndex('5')] - 1].name == "China");
+static_assert(VIN::country_table[VIN::getWMISymbolIndex('S') * VIN::wmi_symbols + VIN::getWMISymbolIndex('5')] == 0);
+
+// The first two symbols of VIN are the index in the country table
+[[nodiscard]] VIN::CountryId VIN::getVINCountryId(std::string_view vin) noexcept
+{
+    if (vin.size() < 2)
+        return 0;
+    const int region = getWMISymbolIndex(vin[0]);
+    const int symbol = getWMISymbolIndex(vin[1]);
+    if (region < 0 || symbol < 0)
+        return 0;
+    return country_table[region * wmi_symbols + symbol];
+}
+
+[[nodiscard]] std::string_view VIN::getCountryName(CountryId id) noexcept
+{
+    if (id == 0 || id > countries) [[unlikely]]
+        return country_not_used;
+    return country_data[id - 1].name;
+}
+
+[[nodiscard]] string VIN::getVINCountry(const string &vin)
+{
+    const Metrics::ScopedTimer timer(Metrics::Function::GET_VIN_COUNTRY);
+    return string(getCountryName(getVINCountryId(vin)));
 }
-//Returns the year of manufacture of the vehicle. If the code is a letter, 
-//the year is calculated based on the position of the letter in the alphabet, 
-//otherwise if the code is a number, just add 2001 + the number.
 [[nodiscard]] int VIN::getTransportYear(const string &vin)
 {
-    const char code = vin[9];
-    int year = 0;
-    if (std::isalpha(code)) {
-        if (code >= 'A' && code <= 'Y') {
-            const int code_alphabet_position = code - 'A' - 1;
-            year += code_alphabet_position + 2010;
-        }
-    } else if (std::isdigit(code)) {
-        const int digit_code = code - '0';
-        year += digit_code + 2000; 
+    const Metrics::ScopedTimer timer(Metrics::Function::GET_TRANSPORT_YEAR);
+    return getModelYear(vin);
+}
+
+static_assert(std::is_trivially_copyable_v<VIN::DecodedVIN>);
+
+[[nodiscard]] VIN::DecodedVIN VIN::decode(std::string_view vin) noexcept
+{
+    const Metrics::ScopedTimer timer(Metrics::Function::DECODE_VIN);
+    DecodedVIN decoded = {};
+    decoded.error = findVINError(vin);
+    if (decoded.error == VINError::INVALID_SIZE)
+        return decoded;
+    vin.copy(decoded.wmi.data(), decoded.wmi.size(), 0);
+    vin.copy(decoded.vds.data(), decoded.vds.size(), 3);
+    decoded.plant = vin[10];
+    vin.copy(decoded.serial.data(), decoded.serial.size(), 11);
+    decoded.model_year = static_cast<std::uint16_t>(getModelYear(vin));
+    decoded.country = getVINCountryId(vin);
+    return decoded;
+}
+
+// Stages of validateVIN are timed separately, the checks themselves are in vin_core.hpp
+[[nodiscard]] VIN::VINError VIN::checkForIllegalCharacters(std::string_view vin) noexcept
+{
+    const Metrics::ScopedTimer timer(Metrics::Function::CHECK_ILLEGAL_CHARACTERS);
+    return findSymbolsError(vin);
+}
+
+[[nodiscard]] bool VIN::checkSum::verifyCheckSum(std::string_view vin) noexcept
+{
+    const Metrics::ScopedTimer timer(Metrics::Function::VERIFY_CHECKSUM);
+    return matchesCheckDigit(vin);
+}
+
+// Symbols after normalization, 0 means the symbol is dropped. Other symbols are kept as is,
+// so validateVIN still reports them
+[[nodiscard]] constexpr std::array<char, 256> VIN::correction::makeNormalizedSymbols() noexcept
+{
+    std::array<char, 256> symbols = {};
+    for (size_t symbol = 0; symbol < symbols.size(); ++symbol)
+        symbols[symbol] = static_cast<char>(symbol);
+    for (int symbol = 'a'; symbol <= 'z'; ++symbol)
+        symbols[symbol] = static_cast<char>(symbol - 'a' + 'A');
+    for (const char symbol : {'I', 'i'})
+        symbols[static_cast<unsigned char>(symbol)] = '1';
+    for (const char symbol : {'O', 'o', 'Q', 'q'})
+        symbols[static_cast<unsigned char>(symbol)] = '0';
+    for (const char symbol : {' ', '\t', '-'})
+        symbols[static_cast<unsigned char>(symbol)] = 0;
+    return symbols;
+}
+
+// Legal symbols of every checksum value, zero-terminated. No symbol has value 10
+[[nodiscard]] constexpr VIN::correction::ValueSymbols VIN::correction::makeValueSymbols() noexcept
+{
+    ValueSymbols symbols = {};
+    std::array<size_t, checksum_modulo> counts = {};
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+        if ((symbol_classes[symbol] & (SYMBOL_LEGAL | SYMBOL_IOQ)) != SYMBOL_LEGAL)
+            continue;
+        const size_t value = checkSum::symbol_values[symbol];
+        symbols[value][counts[value]++] = static_cast<char>(symbol);
     }
-    return year;
+    return symbols;
 }
 
-[[nodiscard]] bool VIN::checkForIllegalCharacters(const string &vin)
+// Multiplicative inverses modulo 11, weights 1..10 are all invertible because 11 is prime
+[[nodiscard]] constexpr std::array<std::uint8_t, VIN::correction::checksum_modulo> VIN::correction::makeInverses() noexcept
 {
-    // Check for checksum integer
-    if (vin[8] != 'X') {
-        if (!std::isdigit(vin[8])) {
-            std::cerr << illegal_vin_number_checksum_error;
-            return false;
+    std::array<std::uint8_t, checksum_modulo> inverses = {};
+    for (size_t value = 1; value < checksum_modulo; ++value) {
+        for (size_t inverse = 1; inverse < checksum_modulo; ++inverse) {
+            if (value * inverse % checksum_modulo == 1)
+                inverses[value] = static_cast<std::uint8_t>(inverse);
         }
     }
-    // Check for illegal characters
-    for (const auto symbol : vin) {
-        const bool first_result = std::isalnum(symbol);
-        if (!first_result) {
-            std::cerr << illegal_vin_number_symbols_error;
-            return false;
-        }
-        if (vin.find_first_of(illegal_chars) != string::npos) {
-            std::cerr << illegal_vin_number_ioq_symbols_error;
-            return false;
-        }
+    return inverses;
+}
 
+namespace VIN {
+    namespace correction {
+        constexpr std::array<char, 256> normalized_symbols = makeNormalizedSymbols();
+        constexpr ValueSymbols value_symbols = makeValueSymbols();
+        constexpr std::array<std::uint8_t, checksum_modulo> inverses = makeInverses();
     }
-    return true;
 }
+static_assert(VIN::correction::normalized_symbols['o'] == '0' && VIN::correction::normalized_symbols['-'] == 0
+              && VIN::correction::normalized_symbols['b'] == 'B');
+static_assert(VIN::correction::value_symbols[2][3] == 'S' && VIN::correction::value_symbols[0][1] == 0
+              && VIN::correction::value_symbols[10][0] == 0);
+static_assert(VIN::correction::inverses[2] == 6 && VIN::correction::inverses[10] == 10);
 
-// Returns char ID based on checksum table for symbols
-[[nodiscard]] inline int VIN::checkSum::getCharId(const char sym)
+[[nodiscard]] std::size_t VIN::normalizeVIN(char *vin, size_t size) noexcept
 {
-    int char_id = 0;
-    if (sym <= 'H')
-        char_id = sym - 'A' + 1;
-    else if (sym >= 'J' && sym <= 'R')
-        char_id = sym - 'H' - 1;
-    else if (sym >= 'S' && sym <= 'Z')
-        char_id = sym - 'R' + 1;
-    return char_id;
+    size_t result_size = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const char symbol = correction::normalized_symbols[static_cast<unsigned char>(vin[i])];
+        vin[result_size] = symbol;
+        result_size += symbol != 0;
+    }
+    return result_size;
 }
-// Algorithm of finding the checksum for VIN number. For reference, see this link
-// https://en.wikipedia.org/wiki/Vehicle_identification_number#Check-digit_calculation
-[[nodiscard]] bool VIN::checkSum::verifyCheckSum(const string &vin)
+
+void VIN::normalizeVIN(string &vin) noexcept
 {
-    int vin_sum = 0;
-    for (size_t i = 0; i < vin.size(); ++i) {
-        // Checksum = we don't want to count this
-        if (i == 8)
-            continue;
-        int num_representation;
-        int weight = getWeight(i + 1);
-        if (std::isalpha(vin[i]))
-            num_representation = getCharId(vin[i]);
-        else
-            num_representation = vin[i] - '0';
-        vin_sum += num_representation * weight; 
-    }
-    const int nearest_smallest_number = (vin_sum / 11) * 11;
-    const int check_sum = vin_sum - nearest_smallest_number; 
-    std::cout << "Calculated checksum: " << check_sum << '\n';
-    std::cout << "VIN checksum: " << vin[8] << '\n';
-    if (check_sum == vin[8] - '0') {
-        return true;
-    } else {
-        std::cerr << checksum_error;
-        return false;
-    }
+    vin.resize(normalizeVIN(vin.data(), vin.size()));
+}
+
+inline void VIN::correction::addCorrection(VINCorrections &corrections, size_t position, char symbol) noexcept
+{
+    corrections.items[corrections.count++] = {static_cast<std::uint8_t>(position), symbol};
 }
 
-// Returns weight of the symbol based on his position
-[[nodiscard]] inline int VIN::checkSum::getWeight(const size_t position)
+// Replacing the symbol at position p changes the sum by weight * (new value - old value), so the
+// new value is (check digit - rest of the sum) / weight modulo 11 and only its symbols are tried
+[[nodiscard]] VIN::VINCorrections VIN::findCorrections(std::string_view vin) noexcept
 {
-    int weight = 0;
-    if (position < 8) {
-        weight = 8;
-        for (size_t i = 1; i < position; ++i)
-            --weight;
-    } else if (position == 8) {
-        weight = 10;
-    } else if (position >= 10) {
-        weight = 9;
-        for (size_t i = 10; i < position; ++i)
-            --weight; 
+    using namespace correction;
+    VINCorrections corrections = {};
+    if (vin.size() != vin_size)
+        return corrections;
+    size_t illegal_position = vin_size;
+    size_t illegal_count = 0;
+    for (size_t i = 0; i < vin_size; ++i) {
+        const std::uint8_t symbol_class = symbol_classes[static_cast<unsigned char>(vin[i])];
+        const bool legal = i == 8 ? (symbol_class & SYMBOL_CHECK_DIGIT) != 0 : (symbol_class & (SYMBOL_LEGAL | SYMBOL_IOQ)) == SYMBOL_LEGAL;
+        if (!legal) {
+            illegal_position = i;
+            ++illegal_count;
+        }
+    }
+    if (illegal_count > 1)
+        return corrections;
+    const int check_sum = checkSum::calculateCheckSum(vin);
+    if (illegal_count == 0 && check_sum == checkSum::getCheckDigitValue(vin[8]))
+        return corrections;
+
+    // The check digit itself
+    if (illegal_count == 0 || illegal_position == 8)
+        addCorrection(corrections, 8, check_sum == 10 ? 'X' : static_cast<char>('0' + check_sum));
+    if (illegal_position == 8)
+        return corrections;
+    const int check_value = checkSum::getCheckDigitValue(vin[8]);
+    const size_t first = illegal_count == 0 ? 0 : illegal_position;
+    const size_t last = illegal_count == 0 ? vin_size - 1 : illegal_position;
+    for (size_t position = first; position <= last; ++position) {
+        const int weight = checkSum::weights[position];
+        if (weight == 0)
+            continue;
+        const int rest = check_sum - weight * checkSum::symbol_values[static_cast<unsigned char>(vin[position])] % static_cast<int>(checksum_modulo);
+        const int difference = ((check_value - rest) % static_cast<int>(checksum_modulo) + static_cast<int>(checksum_modulo)) % static_cast<int>(checksum_modulo);
+        const size_t value = difference * inverses[weight] % checksum_modulo;
+        for (const char *symbol = value_symbols[value].data(); *symbol != 0; ++symbol) {
+            if (*symbol != vin[position])
+                addCorrection(corrections, position, *symbol);
+        }
     }
-    return weight;
+    return corrections;
 }
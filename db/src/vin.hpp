@@ -1,11 +1,86 @@
 #pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
+#include "vin_core.hpp"
 
+//  VINError, getCheckDigit, getModelYear and the constexpr validators are in vin_core.hpp
 namespace VIN {
+    // Checks the VIN number like checkVIN, but without any output and allocations.
+    // Returns the reason why the VIN number is incorrect or VINError::NONE
+    [[nodiscard]] VINError validateVIN(std::string_view vin) noexcept;
+    // Returns the text description of the error
+    [[nodiscard]] const char *getErrorMessage(VINError error) noexcept;
+    // Returns the name of the error code ("INVALID_CHECKSUM") used in the output rows and the metrics
+    [[nodiscard]] std::string_view getErrorName(VINError error) noexcept;
     // Checks the VIN number and returns true or false depending on the correctness of the VIN number
     [[nodiscard]] bool checkVIN(const std::string &vin);
+    // Implementation of checkVINBatch, AUTO picks the fastest one supported by the CPU.
+    // A kernel that is not supported by the CPU is replaced with AUTO
+    enum class BatchKernel {
+        AUTO,
+        SCALAR,
+        SSSE3,
+        AVX2
+    };
+    // Checks count VIN numbers stored back to back as 17-byte records (no separators) and
+    // returns a validity bitmap: bit (i % 64) of word (i / 64) is set if the i-th VIN is correct
+    [[nodiscard]] std::vector<std::uint64_t> checkVINBatch(const char *records, std::size_t count,
+                                                           BatchKernel kernel = BatchKernel::AUTO);
+    // Same as checkVINBatch, but the bitmap is written to the (count + 63) / 64 words of bitmap without allocations
+    void checkVINBatch(const char *records, std::size_t count, std::uint64_t *bitmap,
+                       BatchKernel kernel = BatchKernel::AUTO) noexcept;
+    // Compact ID of the country, 0 means "Not used"
+    using CountryId = std::uint8_t;
     // Returns VIN country, if not found - returns "Not used"
     [[nodiscard]] std::string getVINCountry(const std::string &vin);
-    //Returns the year in which the vehicle was manufactured from 2001 to 2029
+    // Returns VIN country ID with a single table lookup, if not found - returns 0
+    [[nodiscard]] CountryId getVINCountryId(std::string_view vin) noexcept;
+    // Returns the country name of the ID, the view is valid during the whole program
+    [[nodiscard]] std::string_view getCountryName(CountryId id) noexcept;
+    //Returns the model year of the vehicle from 1980 to 2039, if the year code is invalid - returns 0.
+    //The cycle is chosen by position 7 (see getModelYear), earlier versions returned 2000-2033 (see README)
     [[nodiscard]] int getTransportYear(const std::string &vin);
+
+    // All the VIN parts decoded in one pass. The struct is trivially copyable
+    // so it can be stored in arrays or split into columns as is
+    struct DecodedVIN {
+        std::array<char, 3> wmi;    // World manufacturer identifier, positions 1-3
+        std::array<char, 5> vds;    // Vehicle descriptor without the check digit, positions 4-8
+        char plant;                 // Plant code, position 11
+        std::array<char, 6> serial; // Serial number, positions 12-17
+        std::uint16_t model_year;   // Same as getTransportYear
+        CountryId country;          // Same as getVINCountryId
+        VINError error;             // Same as validateVIN
+
+        [[nodiscard]] bool valid() const noexcept { return error == VINError::NONE; }
+    };
+    // Validates and decodes the VIN number without output and allocations, the error is not counted by the metrics.
+    // VIN parts are filled even if the checksum is wrong, but not if the size is wrong
+    [[nodiscard]] DecodedVIN decode(std::string_view vin) noexcept;
+
+    // Canonical form of a scanned VIN, in place: spaces, tabs and dashes are removed, lowercase letters
+    // become capital ones, I becomes 1, O and Q become 0. Returns the new size of the VIN
+    [[nodiscard]] std::size_t normalizeVIN(char *vin, std::size_t size) noexcept;
+    void normalizeVIN(std::string &vin) noexcept;
+
+    // Replacing the symbol at position (0-based) with symbol gives a valid VIN
+    struct VINCorrection {
+        std::uint8_t position;
+        char symbol;
+    };
+    // At most 4 symbols share the checksum value of another symbol, plus the check digit itself
+    inline constexpr std::size_t max_vin_corrections = 16 * 4 + 1;
+    struct VINCorrections {
+        std::array<VINCorrection, max_vin_corrections> items;
+        std::size_t count;
+    };
+    // All single-symbol substitutions that make a VIN valid, in the order of positions.
+    // Works for VIN numbers with a wrong checksum or one illegal symbol (only that symbol is replaced),
+    // valid VIN numbers and VIN numbers with the wrong size or more illegal symbols have no corrections.
+    // Every position has only one checksum value that fixes the VIN, so just the symbols of that value are tried
+    [[nodiscard]] VINCorrections findCorrections(std::string_view vin) noexcept;
 }
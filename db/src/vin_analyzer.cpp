@@ -0,0 +1,143 @@
+//C interface of the library: thin loops over the C++ functions, see vin_analyzer.h
+#include "vin_analyzer.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include "plate_format.hpp"
+#include "reg_mark.hpp"
+#include "vin.hpp"
+
+using size_t = std::size_t;
+using uint32_t = std::uint32_t;
+
+namespace {
+    // Values past region 999 don't correspond to any mark
+    constexpr uint32_t mark_values = (RegMark::Mark::max_region + 1) * RegMark::Mark::marks_in_region;
+
+    [[nodiscard]] bool isVINErrorCode(int error) noexcept
+    {
+        return error >= VIN_ERROR_NONE && error <= VIN_ERROR_INVALID_CHECKSUM;
+    }
+    [[nodiscard]] bool isMarkErrorCode(int error) noexcept
+    {
+        return error >= VIN_MARK_ERROR_NONE && error <= VIN_MARK_ERROR_INVALID_REGION;
+    }
+}
+
+static_assert(static_cast<int>(VIN::VINError::INVALID_SIZE) == VIN_ERROR_INVALID_SIZE
+              && static_cast<int>(VIN::VINError::INVALID_CHECKSUM) == VIN_ERROR_INVALID_CHECKSUM);
+static_assert(static_cast<int>(RegMark::MarkError::INVALID_SIZE) == VIN_MARK_ERROR_INVALID_SIZE
+              && static_cast<int>(RegMark::MarkError::INVALID_REGION) == VIN_MARK_ERROR_INVALID_REGION);
+static_assert(VIN::vin_size == VIN_RECORD_SIZE && RegMark::PrivateFormat::size == VIN_MARK_RECORD_SIZE);
+static_assert(mark_values - 1 < VIN_MARK_INVALID);
+static_assert(std::is_standard_layout_v<vin_decoded> && sizeof(vin_decoded) == 20);
+
+extern "C" uint32_t vin_abi_version(void)
+{
+    return VIN_ANALYZER_ABI_VERSION;
+}
+
+extern "C" int vin_validate(const char *vin, size_t size)
+{
+    return static_cast<int>(VIN::validateVIN(std::string_view(vin, size)));
+}
+
+extern "C" const char *vin_error_message(int error)
+{
+    return isVINErrorCode(error) ? VIN::getErrorMessage(static_cast<VIN::VINError>(error)) : "";
+}
+
+// Country names are string literals, so the views are zero-terminated
+extern "C" const char *vin_country_name(uint8_t country)
+{
+    return VIN::getCountryName(country).data();
+}
+
+extern "C" size_t vin_check_batch(const char *records, size_t count, uint64_t *bitmap)
+{
+    VIN::checkVINBatch(records, count, bitmap);
+    size_t valid = 0;
+    for (size_t i = 0; i < (count + 63) / 64; ++i)
+        valid += static_cast<size_t>(std::popcount(bitmap[i]));
+    return valid;
+}
+
+extern "C" size_t vin_validate_batch(const char *records, size_t count, uint8_t *errors)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const VIN::VINError error = VIN::validateVIN(std::string_view(records + i * VIN_RECORD_SIZE, VIN_RECORD_SIZE));
+        errors[i] = static_cast<uint8_t>(error);
+        valid += error == VIN::VINError::NONE;
+    }
+    return valid;
+}
+
+// Fields are copied one by one, the C struct doesn't depend on the layout of VIN::DecodedVIN
+extern "C" size_t vin_decode_batch(const char *records, size_t count, vin_decoded *decoded)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const VIN::DecodedVIN source = VIN::decode(std::string_view(records + i * VIN_RECORD_SIZE, VIN_RECORD_SIZE));
+        vin_decoded &target = decoded[i];
+        std::memcpy(target.wmi, source.wmi.data(), sizeof(target.wmi));
+        std::memcpy(target.vds, source.vds.data(), sizeof(target.vds));
+        target.plant = source.plant;
+        std::memcpy(target.serial, source.serial.data(), sizeof(target.serial));
+        target.model_year = source.model_year;
+        target.country = source.country;
+        target.error = static_cast<uint8_t>(source.error);
+        valid += source.valid();
+    }
+    return valid;
+}
+
+extern "C" int vin_mark_validate(const char *mark, size_t size)
+{
+    return static_cast<int>(RegMark::ValidateMark(std::string_view(mark, size)));
+}
+
+extern "C" const char *vin_mark_error_message(int error)
+{
+    return isMarkErrorCode(error) ? RegMark::GetErrorMessage(static_cast<RegMark::MarkError>(error)) : "";
+}
+
+extern "C" size_t vin_mark_validate_batch(const char *records, size_t record_size, size_t count, uint8_t *errors)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const RegMark::MarkError error = RegMark::ValidateMark(std::string_view(records + i * record_size, record_size));
+        errors[i] = static_cast<uint8_t>(error);
+        valid += error == RegMark::MarkError::NONE;
+    }
+    return valid;
+}
+
+extern "C" size_t vin_mark_encode_batch(const char *records, size_t record_size, size_t count, uint32_t *values)
+{
+    size_t encoded = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const std::optional<RegMark::Mark> mark = RegMark::Mark::Parse(std::string_view(records + i * record_size, record_size));
+        values[i] = mark ? mark->Value() : VIN_MARK_INVALID;
+        encoded += mark.has_value();
+    }
+    return encoded;
+}
+
+extern "C" size_t vin_mark_format_batch(const uint32_t *values, size_t count, char *records)
+{
+    size_t formatted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        char *record = records + i * VIN_MARK_RECORD_SIZE;
+        if (values[i] >= mark_values) {
+            std::fill(record, record + VIN_MARK_RECORD_SIZE, '\0');
+            continue;
+        }
+        RegMark::Mark::FromValue(values[i]).FormatTo(record);
+        ++formatted;
+    }
+    return formatted;
+}
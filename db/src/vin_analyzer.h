@@ -0,0 +1,98 @@
+#ifndef VIN_ANALYZER_H
+#define VIN_ANALYZER_H
+/*  Stable C interface of the vin_analyzer library, the only symbols exported from the shared library.
+ *  Every batch function handles a whole array in one call, so a foreign function interface pays for
+ *  one call per batch instead of one per item. No function allocates memory or keeps the pointers,
+ *  output arrays are provided by the caller.
+ *  New functions may be added, the existing ones and the values of the constants never change. */
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define VIN_API __attribute__((visibility("default")))
+#else
+#define VIN_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented when functions are added */
+#define VIN_ANALYZER_ABI_VERSION 1
+
+/* Same values as VIN::VINError */
+enum {
+    VIN_ERROR_NONE = 0,
+    VIN_ERROR_INVALID_SIZE = 1,
+    VIN_ERROR_ILLEGAL_SYMBOLS = 2,
+    VIN_ERROR_ILLEGAL_IOQ_SYMBOLS = 3,
+    VIN_ERROR_INVALID_CHECK_DIGIT_SYMBOL = 4,
+    VIN_ERROR_INVALID_CHECKSUM = 5
+};
+/* Same values as RegMark::MarkError */
+enum {
+    VIN_MARK_ERROR_NONE = 0,
+    VIN_MARK_ERROR_INVALID_SIZE = 1,
+    VIN_MARK_ERROR_ILLEGAL_SYMBOLS = 2,
+    VIN_MARK_ERROR_ILLEGAL_LATIN_SYMBOLS = 3,
+    VIN_MARK_ERROR_INVALID_DIGITS = 4,
+    VIN_MARK_ERROR_INVALID_SERIES = 5,
+    VIN_MARK_ERROR_INVALID_REGION = 6
+};
+
+/* Size of the VIN records of the batch functions */
+#define VIN_RECORD_SIZE 17
+/* Size of the formatted marks, vin_mark_format_batch always writes a999aa999 */
+#define VIN_MARK_RECORD_SIZE 9
+/* Value of the marks that can't be encoded */
+#define VIN_MARK_INVALID UINT32_MAX
+
+/* Same as VIN::DecodedVIN, the symbols are not zero-terminated */
+typedef struct vin_decoded {
+    char wmi[3];
+    char vds[5];
+    char plant;
+    char serial[6];
+    uint16_t model_year;    /* 1980..2039, 0 if the year code is invalid */
+    uint8_t country;        /* See vin_country_name, 0 means "Not used" */
+    uint8_t error;          /* VIN_ERROR_* */
+} vin_decoded;
+
+/* VIN_ANALYZER_ABI_VERSION of the library, may be newer than the one of the header */
+VIN_API uint32_t vin_abi_version(void);
+
+/* Returns VIN_ERROR_* of one VIN of size symbols */
+VIN_API int vin_validate(const char *vin, size_t size);
+/* Zero-terminated description of VIN_ERROR_*, empty for VIN_ERROR_NONE and unknown codes */
+VIN_API const char *vin_error_message(int error);
+/* Zero-terminated country name of vin_decoded.country, valid during the whole program */
+VIN_API const char *vin_country_name(uint8_t country);
+
+/* count VINs stored back to back as VIN_RECORD_SIZE-byte records (no separators).
+ * Sets bit (i % 64) of bitmap[i / 64] if the i-th VIN is correct, bitmap must have (count + 63) / 64 words.
+ * Uses the fastest kernel supported by the CPU. Returns the number of correct VINs */
+VIN_API size_t vin_check_batch(const char *records, size_t count, uint64_t *bitmap);
+/* Writes VIN_ERROR_* of every record to errors[i]. Returns the number of correct VINs */
+VIN_API size_t vin_validate_batch(const char *records, size_t count, uint8_t *errors);
+/* Decodes every record to decoded[i]. Returns the number of correct VINs */
+VIN_API size_t vin_decode_batch(const char *records, size_t count, vin_decoded *decoded);
+
+/* Returns VIN_MARK_ERROR_* of one license plate number of size symbols (a999aa999 or a999aa99) */
+VIN_API int vin_mark_validate(const char *mark, size_t size);
+/* Zero-terminated description of VIN_MARK_ERROR_* */
+VIN_API const char *vin_mark_error_message(int error);
+/* count marks stored back to back as record_size-byte records (8 or 9).
+ * Writes VIN_MARK_ERROR_* of every record to errors[i]. Returns the number of correct marks */
+VIN_API size_t vin_mark_validate_batch(const char *records, size_t record_size, size_t count, uint8_t *errors);
+/* Packs every record to values[i] (RegMark::Mark::Value: region, then series, then number),
+ * VIN_MARK_INVALID if the mark is invalid. Returns the number of encoded marks */
+VIN_API size_t vin_mark_encode_batch(const char *records, size_t record_size, size_t count, uint32_t *values);
+/* Writes every value of vin_mark_encode_batch as a VIN_MARK_RECORD_SIZE-byte record to records
+ * (no separators), VIN_MARK_INVALID and other values past region 999 as zero bytes. Returns the number of formatted marks */
+VIN_API size_t vin_mark_format_batch(const uint32_t *values, size_t count, char *records);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
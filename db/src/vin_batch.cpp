@@ -0,0 +1,260 @@
+//Batch validation of VIN numbers stored as fixed 17-byte records.
+//Three kernels do the same work: AVX2 (8 VINs per step, records are gathered column-wise),
+//SSSE3 (one VIN per step) and plain scalar code. The kernel is chosen at runtime by the CPU features.
+//Checksum tables are built from the ones of vin_core.hpp
+
+#include <algorithm>
+#include <array>
+#include "vin.hpp"
+#include "metrics.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VIN_BATCH_X86
+#endif
+
+using size_t = std::size_t;
+using uint8_t = std::uint8_t;
+using uint64_t = std::uint64_t;
+
+namespace VIN {
+    namespace batch {
+        const size_t record_size = vin_size;
+        const int check_digit_ten = 10;
+        // Weight of every position, the check digit itself is not counted
+        using checkSum::weights;
+
+        [[nodiscard]] constexpr int getLegalValue(int symbol) noexcept;
+        [[nodiscard]] constexpr std::array<uint8_t, 16> makeLetterValues(int first) noexcept;
+        [[nodiscard]] constexpr std::array<std::int8_t, 256> makeSymbolValues() noexcept;
+        [[nodiscard]] inline int getSymbolValue(const char symbol);
+        [[nodiscard]] inline int getCheckDigitValue(const char symbol);
+        [[nodiscard]] inline bool checkRecord(const char *vin);
+        void checkRecordsScalar(const char *records, size_t first, size_t count, uint64_t *bitmap);
+#ifdef VIN_BATCH_X86
+        void checkRecordsSSSE3(const char *records, size_t count, uint64_t *bitmap);
+        void checkRecordsAVX2(const char *records, size_t count, uint64_t *bitmap);
+#endif
+    }
+}
+
+[[nodiscard]] std::vector<uint64_t> VIN::checkVINBatch(const char *records, size_t count, BatchKernel kernel)
+{
+    std::vector<uint64_t> bitmap((count + 63) / 64, 0);
+    checkVINBatch(records, count, bitmap.data(), kernel);
+    return bitmap;
+}
+
+// Kernels only set the bits of the valid VIN numbers, so the bitmap is cleared first
+void VIN::checkVINBatch(const char *records, size_t count, uint64_t *bitmap, BatchKernel kernel) noexcept
+{
+    const Metrics::ScopedTimer timer(Metrics::Function::CHECK_VIN_BATCH);
+    std::fill(bitmap, bitmap + (count + 63) / 64, uint64_t{0});
+#ifdef VIN_BATCH_X86
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    const bool ssse3 = __builtin_cpu_supports("ssse3");
+    if ((kernel == BatchKernel::AVX2 && !avx2) || (kernel == BatchKernel::SSSE3 && !ssse3))
+        kernel = BatchKernel::AUTO;
+    if (kernel == BatchKernel::AUTO)
+        kernel = avx2 ? BatchKernel::AVX2 : ssse3 ? BatchKernel::SSSE3 : BatchKernel::SCALAR;
+    if (kernel == BatchKernel::AVX2)
+        batch::checkRecordsAVX2(records, count, bitmap);
+    else if (kernel == BatchKernel::SSSE3)
+        batch::checkRecordsSSSE3(records, count, bitmap);
+    else
+#endif
+        batch::checkRecordsScalar(records, 0, count, bitmap);
+}
+
+// Value of the checksum table (vin_core.hpp) or -1 if the symbol can't be used in VIN
+[[nodiscard]] constexpr int VIN::batch::getLegalValue(int symbol) noexcept
+{
+    const uint8_t symbol_class = symbol_classes[static_cast<unsigned char>(symbol)];
+    return (symbol_class & (SYMBOL_LEGAL | SYMBOL_IOQ)) == SYMBOL_LEGAL ? checkSum::symbol_values[static_cast<unsigned char>(symbol)] : -1;
+}
+
+// Shuffle table of 16 letters starting at 'A' + first, illegal letters and positions past 'Z' are zero
+[[nodiscard]] constexpr std::array<uint8_t, 16> VIN::batch::makeLetterValues(int first) noexcept
+{
+    std::array<uint8_t, 16> values = {};
+    for (int i = 0; i < 16 && first + i < 26; ++i)
+        values[i] = static_cast<uint8_t>(std::max(getLegalValue('A' + first + i), 0));
+    return values;
+}
+
+// Numeric value of every byte, -1 if the symbol can't be used in VIN
+[[nodiscard]] constexpr std::array<std::int8_t, 256> VIN::batch::makeSymbolValues() noexcept
+{
+    std::array<std::int8_t, 256> values = {};
+    for (int symbol = 0; symbol < 256; ++symbol)
+        values[symbol] = static_cast<std::int8_t>(getLegalValue(symbol));
+    return values;
+}
+
+namespace VIN {
+    namespace batch {
+        constexpr std::array<std::int8_t, 256> symbol_values = makeSymbolValues();
+        // Letters 'A'..'P' and 'Q'..'Z' for the shuffles of the vector kernels
+        constexpr std::array<uint8_t, 16> low_letter_values = makeLetterValues(0);
+        constexpr std::array<uint8_t, 16> high_letter_values = makeLetterValues(16);
+    }
+}
+static_assert(VIN::batch::symbol_values['Z'] == 9 && VIN::batch::symbol_values['O'] == -1 && VIN::batch::symbol_values['a'] == -1);
+static_assert(VIN::batch::low_letter_values[8] == 0 && VIN::batch::low_letter_values[15] == 7
+              && VIN::batch::high_letter_values[0] == 0 && VIN::batch::high_letter_values[9] == 9 && VIN::batch::high_letter_values[10] == 0);
+
+[[nodiscard]] inline int VIN::batch::getSymbolValue(const char symbol)
+{
+    return symbol_values[static_cast<unsigned char>(symbol)];
+}
+
+// Returns value of the check digit ('X' stands for 10) or -1 if it is not set properly
+[[nodiscard]] inline int VIN::batch::getCheckDigitValue(const char symbol)
+{
+    if (symbol == 'X')
+        return check_digit_ten;
+    if (symbol >= '0' && symbol <= '9')
+        return symbol - '0';
+    return -1;
+}
+
+// Illegal symbols are collected in one flag, so the loop has no branches
+[[nodiscard]] inline bool VIN::batch::checkRecord(const char *vin)
+{
+    int vin_sum = 0;
+    int illegal = 0;
+    for (size_t i = 0; i < record_size; ++i) {
+        const int value = getSymbolValue(vin[i]);
+        illegal |= value;
+        vin_sum += value * weights[i];
+    }
+    return illegal >= 0 && vin_sum % 11 == getCheckDigitValue(vin[check_digit_position]);
+}
+
+void VIN::batch::checkRecordsScalar(const char *records, size_t first, size_t count, uint64_t *bitmap)
+{
+    for (size_t i = first; i < count; ++i) {
+        if (checkRecord(records + i * record_size))
+            bitmap[i / 64] |= uint64_t{1} << (i % 64);
+    }
+}
+
+#ifdef VIN_BATCH_X86
+// One VIN per step: positions 0..15 are handled as one 16-byte vector, the last position is scalar
+__attribute__((target("ssse3")))
+void VIN::batch::checkRecordsSSSE3(const char *records, size_t count, uint64_t *bitmap)
+{
+    const __m128i weights_vector = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights.data()));
+    const __m128i low_letters = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low_letter_values.data()));
+    // The tail of the vector past 'Z' is never selected
+    const __m128i high_letters = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high_letter_values.data()));
+    const __m128i ones = _mm_set1_epi16(1);
+
+    for (size_t i = 0; i < count; ++i) {
+        const char *vin = records + i * record_size;
+        const __m128i symbols = _mm_loadu_si128(reinterpret_cast<const __m128i *>(vin));
+
+        const __m128i digits = _mm_sub_epi8(symbols, _mm_set1_epi8('0'));
+        const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+        const __m128i letters = _mm_sub_epi8(symbols, _mm_set1_epi8('A'));
+        const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(25)), letters);
+        const __m128i is_low_letter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(15)), letters);
+        const __m128i low_values = _mm_shuffle_epi8(low_letters, letters);
+        const __m128i high_values = _mm_shuffle_epi8(high_letters, _mm_sub_epi8(letters, _mm_set1_epi8(16)));
+        const __m128i letter_value = _mm_and_si128(is_letter, _mm_or_si128(_mm_and_si128(is_low_letter, low_values),
+                                                                           _mm_andnot_si128(is_low_letter, high_values)));
+
+        const __m128i legal = _mm_or_si128(is_digit, _mm_andnot_si128(_mm_cmpeq_epi8(letter_value, _mm_setzero_si128()), is_letter));
+        if (_mm_movemask_epi8(legal) != 0xFFFF)
+            continue;
+        const int last_value = getSymbolValue(vin[record_size - 1]);
+        const int check_value = getCheckDigitValue(vin[check_digit_position]);
+        if (last_value < 0 || check_value < 0)
+            continue;
+
+        const __m128i values = _mm_or_si128(_mm_and_si128(is_digit, digits), letter_value);
+        __m128i sum = _mm_madd_epi16(_mm_maddubs_epi16(values, weights_vector), ones);
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        const int vin_sum = _mm_cvtsi128_si32(sum) + last_value * weights[record_size - 1];
+        if (vin_sum % 11 == check_value)
+            bitmap[i / 64] |= uint64_t{1} << (i % 64);
+    }
+}
+
+// Eight VINs per step. Every gather loads 4 consecutive symbols of 8 records into 32-bit lanes,
+// so each lane accumulates the checksum of its own VIN and mod 11 is computed for all lanes at once.
+// Gathers start at positions 0, 4, 8, 12 and 13, the last one is used only for position 16
+// to never read past the end of the buffer.
+__attribute__((target("avx2")))
+void VIN::batch::checkRecordsAVX2(const char *records, size_t count, uint64_t *bitmap)
+{
+    const size_t lanes = 8;
+    constexpr std::array<size_t, 5> offsets = {0, 4, 8, 12, 13};
+    const __m256i record_index = _mm256_setr_epi32(0, 17, 34, 51, 68, 85, 102, 119);
+    const __m256i low_letters = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(low_letter_values.data())));
+    const __m256i high_letters = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(high_letter_values.data())));
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i all_set = _mm256_set1_epi32(-1);
+
+    __m256i gather_weights[offsets.size()];
+    for (size_t k = 0; k < offsets.size(); ++k) {
+        int packed = 0;
+        for (size_t j = 0; j < 4; ++j)
+            packed |= weights[offsets[k] + j] << (8 * j);
+        gather_weights[k] = _mm256_set1_epi32(packed);
+    }
+    // Positions 13..15 are already counted by the gather at position 12
+    gather_weights[4] = _mm256_and_si256(gather_weights[4], _mm256_set1_epi32(0xFF000000));
+    const __m256i overlap_legal = _mm256_set1_epi32(0x00FFFFFF);
+
+    const size_t blocks_end = count - count % lanes;
+    for (size_t i = 0; i < blocks_end; i += lanes) {
+        const char *block = records + i * record_size;
+        __m256i legal_all = all_set;
+        __m256i vin_sum = _mm256_setzero_si256();
+        __m256i check_symbols = _mm256_setzero_si256();
+
+        for (size_t k = 0; k < offsets.size(); ++k) {
+            const __m256i symbols = _mm256_i32gather_epi32(reinterpret_cast<const int *>(block + offsets[k]), record_index, 1);
+            if (offsets[k] == check_digit_position)
+                check_symbols = _mm256_and_si256(symbols, _mm256_set1_epi32(0xFF));
+
+            const __m256i digits = _mm256_sub_epi8(symbols, _mm256_set1_epi8('0'));
+            const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+            const __m256i letters = _mm256_sub_epi8(symbols, _mm256_set1_epi8('A'));
+            const __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8(25)), letters);
+            const __m256i is_low_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8(15)), letters);
+            const __m256i low_values = _mm256_shuffle_epi8(low_letters, letters);
+            const __m256i high_values = _mm256_shuffle_epi8(high_letters, _mm256_sub_epi8(letters, _mm256_set1_epi8(16)));
+            const __m256i letter_value = _mm256_and_si256(is_letter, _mm256_blendv_epi8(high_values, low_values, is_low_letter));
+
+            __m256i legal = _mm256_or_si256(is_digit, _mm256_andnot_si256(_mm256_cmpeq_epi8(letter_value, _mm256_setzero_si256()), is_letter));
+            if (k == offsets.size() - 1)
+                legal = _mm256_or_si256(legal, overlap_legal);
+            legal_all = _mm256_and_si256(legal_all, legal);
+
+            const __m256i values = _mm256_or_si256(_mm256_and_si256(is_digit, digits), letter_value);
+            vin_sum = _mm256_add_epi32(vin_sum, _mm256_madd_epi16(_mm256_maddubs_epi16(values, gather_weights[k]), ones));
+        }
+
+        // Check digit is a digit or 'X' (stands for 10)
+        const __m256i check_digits = _mm256_sub_epi32(check_symbols, _mm256_set1_epi32('0'));
+        const __m256i is_check_digit = _mm256_and_si256(_mm256_cmpgt_epi32(check_digits, _mm256_set1_epi32(-1)),
+                                                        _mm256_cmpgt_epi32(_mm256_set1_epi32(10), check_digits));
+        const __m256i is_check_ten = _mm256_cmpeq_epi32(check_symbols, _mm256_set1_epi32('X'));
+        const __m256i check_value = _mm256_blendv_epi8(check_digits, _mm256_set1_epi32(check_digit_ten), is_check_ten);
+
+        // vin_sum / 11 == (vin_sum * 745) >> 13 for every possible sum (max is 801)
+        const __m256i quotient = _mm256_srli_epi32(_mm256_mullo_epi32(vin_sum, _mm256_set1_epi32(745)), 13);
+        const __m256i remainder = _mm256_sub_epi32(vin_sum, _mm256_mullo_epi32(quotient, _mm256_set1_epi32(11)));
+
+        __m256i valid = _mm256_cmpeq_epi32(legal_all, all_set);
+        valid = _mm256_and_si256(valid, _mm256_or_si256(is_check_digit, is_check_ten));
+        valid = _mm256_and_si256(valid, _mm256_cmpeq_epi32(remainder, check_value));
+        const uint64_t mask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(valid)));
+        bitmap[i / 64] |= mask << (i % 64);
+    }
+    checkRecordsScalar(records, blocks_end, count, bitmap);
+}
+#endif
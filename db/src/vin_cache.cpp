@@ -0,0 +1,141 @@
+//Sharded set-associative cache of decoded VIN numbers
+#include "vin_cache.hpp"
+#include <algorithm>
+#include <bit>
+#include <thread>
+
+using size_t = std::size_t;
+using uint64_t = std::uint64_t;
+
+namespace VIN {
+    const size_t cache_vin_size = 17;
+    const size_t shards_per_thread = 4;
+    //  6-bit codes of the symbols: digits are 1..10, capital letters are 11..36, 0 means "can't be cached"
+    [[nodiscard]] constexpr std::array<std::uint8_t, 256> makeSymbolCodes() noexcept;
+}
+
+[[nodiscard]] constexpr std::array<std::uint8_t, 256> VIN::makeSymbolCodes() noexcept
+{
+    std::array<std::uint8_t, 256> codes = {};
+    for (int symbol = '0'; symbol <= '9'; ++symbol)
+        codes[symbol] = static_cast<std::uint8_t>(symbol - '0' + 1);
+    for (int symbol = 'A'; symbol <= 'Z'; ++symbol)
+        codes[symbol] = static_cast<std::uint8_t>(symbol - 'A' + 11);
+    return codes;
+}
+
+namespace VIN {
+    constexpr std::array<std::uint8_t, 256> symbol_codes = makeSymbolCodes();
+}
+static_assert(VIN::symbol_codes['Z'] < 64 && VIN::symbol_codes['a'] == 0);
+
+// Both the shard count and the sets per shard are powers of two, so the hash is split by masks
+VIN::DecodeCache::DecodeCache(size_t capacity, size_t shards)
+{
+    if (shards == 0)
+        shards = std::max<size_t>(1, std::thread::hardware_concurrency()) * shards_per_thread;
+    shard_count = std::bit_ceil(shards);
+    const size_t sets = (std::max<size_t>(capacity, 1) + ways - 1) / ways;
+    sets_per_shard = std::bit_ceil((sets + shard_count - 1) / shard_count);
+    this->shards = std::make_unique<Shard[]>(shard_count);
+    for (size_t i = 0; i < shard_count; ++i)
+        this->shards[i].entries.resize(sets_per_shard * ways, Entry{});
+}
+
+// 17 symbols by 6 bits: 10 symbols in the first word and 7 in the second one
+[[nodiscard]] bool VIN::DecodeCache::packKey(std::string_view vin, Key &key) noexcept
+{
+    if (vin.size() != cache_vin_size)
+        return false;
+    uint64_t high = 0;
+    uint64_t low = 0;
+    std::uint8_t missing = 0;
+    for (size_t i = 0; i < 10; ++i) {
+        const std::uint8_t code = symbol_codes[static_cast<unsigned char>(vin[i])];
+        missing |= code == 0;
+        high = high << 6 | code;
+    }
+    for (size_t i = 10; i < cache_vin_size; ++i) {
+        const std::uint8_t code = symbol_codes[static_cast<unsigned char>(vin[i])];
+        missing |= code == 0;
+        low = low << 6 | code;
+    }
+    key = {high, low};
+    return missing == 0;
+}
+
+[[nodiscard]] uint64_t VIN::DecodeCache::hashKey(const Key &key) noexcept
+{
+    uint64_t hash = (key.high ^ std::rotl(key.low, 29)) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+// The VIN is decoded outside of the lock, so a slow miss doesn't block the hits of the shard
+[[nodiscard]] VIN::DecodedVIN VIN::DecodeCache::Decode(std::string_view vin) noexcept
+{
+    Key key;
+    if (!packKey(vin, key)) {
+        uncached.fetch_add(1, std::memory_order_relaxed);
+        return decode(vin);
+    }
+    const uint64_t hash = hashKey(key);
+    Shard &shard = shards[hash & (shard_count - 1)];
+    Entry *const set = shard.entries.data() + (hash / shard_count & (sets_per_shard - 1)) * ways;
+    {
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+        for (size_t way = 0; way < ways; ++way) {
+            if (set[way].key.high == key.high && set[way].key.low == key.low) {
+                set[way].last_use = ++shard.clock;
+                ++shard.hits;
+                return set[way].decoded;
+            }
+        }
+        ++shard.misses;
+    }
+
+    const DecodedVIN decoded = decode(vin);
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    // Another thread may have inserted the same VIN meanwhile, otherwise the oldest entry is replaced
+    Entry *victim = set;
+    for (size_t way = 0; way < ways; ++way) {
+        if (set[way].key.high == key.high && set[way].key.low == key.low)
+            return decoded;
+        if (set[way].last_use < victim->last_use)
+            victim = set + way;
+    }
+    if (victim->key.high != 0)
+        ++shard.evictions;
+    else
+        ++shard.size;
+    *victim = {key, decoded, ++shard.clock};
+    return decoded;
+}
+
+[[nodiscard]] VIN::DecodeCache::Stats VIN::DecodeCache::GetStats() const noexcept
+{
+    Stats stats = {};
+    stats.misses = uncached.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < shard_count; ++i) {
+        const std::lock_guard<std::mutex> lock(shards[i].mutex);
+        stats.hits += shards[i].hits;
+        stats.misses += shards[i].misses;
+        stats.evictions += shards[i].evictions;
+        stats.size += shards[i].size;
+    }
+    return stats;
+}
+
+void VIN::DecodeCache::Clear() noexcept
+{
+    uncached.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < shard_count; ++i) {
+        Shard &shard = shards[i];
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+        std::fill(shard.entries.begin(), shard.entries.end(), Entry{});
+        shard.clock = 0;
+        shard.hits = 0;
+        shard.misses = 0;
+        shard.evictions = 0;
+        shard.size = 0;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "vin.hpp"
+
+namespace VIN {
+    //  Fixed-capacity memoizing cache in front of decode for feeds that repeat the same vehicles.
+    //  The VIN is packed into two 64-bit words (6 bits per symbol) and hashed to a shard and to a set
+    //  of 8 entries inside it. Every shard has its own mutex, so threads mostly lock different shards.
+    //  The least recently used entry of the set is replaced. No allocations after construction.
+    class DecodeCache {
+    public:
+        static constexpr std::size_t default_capacity = 1 << 16;
+        static constexpr std::size_t ways = 8;
+
+        struct Stats {
+            std::uint64_t hits;
+            std::uint64_t misses;
+            std::uint64_t evictions;
+            std::size_t size;
+        };
+
+        //  Capacity is rounded up to whole sets, 0 shards means four shards per hardware thread
+        explicit DecodeCache(std::size_t capacity = default_capacity, std::size_t shards = 0);
+        DecodeCache(const DecodeCache &) = delete;
+        DecodeCache &operator=(const DecodeCache &) = delete;
+
+        //  Same result as decode. VIN numbers with symbols other than digits and capital letters
+        //  (or with the wrong size) are decoded directly and counted as misses
+        [[nodiscard]] DecodedVIN Decode(std::string_view vin) noexcept;
+        [[nodiscard]] Stats GetStats() const noexcept;
+        void Clear() noexcept;
+        [[nodiscard]] std::size_t Capacity() const noexcept { return shard_count * sets_per_shard * ways; }
+    private:
+        struct Key {
+            std::uint64_t high;     // symbols 1-10, 0 marks an empty entry
+            std::uint64_t low;      // symbols 11-17
+        };
+        struct Entry {
+            Key key;
+            DecodedVIN decoded;
+            std::uint64_t last_use;
+        };
+        struct alignas(64) Shard {
+            mutable std::mutex mutex;
+            std::vector<Entry> entries;
+            std::uint64_t clock = 0;
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+            std::size_t size = 0;
+        };
+
+        [[nodiscard]] static bool packKey(std::string_view vin, Key &key) noexcept;
+        [[nodiscard]] static std::uint64_t hashKey(const Key &key) noexcept;
+
+        std::unique_ptr<Shard[]> shards;
+        std::size_t shard_count;
+        std::size_t sets_per_shard;
+        std::atomic<std::uint64_t> uncached{0};
+    };
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//  Header-only core of the VIN checks: the symbol tables are built at compile time and every function
+//  is constexpr on std::string_view, so the checks can be evaluated in constant expressions and are
+//  inlined into the callers. vin.hpp adds the metrics, the batch kernels and the decoders on top of it,
+//  the checksum algorithm is described here:
+//  https://en.wikipedia.org/wiki/Vehicle_identification_number#Check-digit_calculation
+namespace VIN {
+    enum class VINError : std::uint8_t {
+        NONE,
+        INVALID_SIZE,
+        ILLEGAL_SYMBOLS,
+        ILLEGAL_IOQ_SYMBOLS,
+        INVALID_CHECK_DIGIT_SYMBOL,
+        INVALID_CHECKSUM
+    };
+
+    inline constexpr std::size_t vin_size = 17;
+    inline constexpr std::size_t check_digit_position = 8;
+    inline constexpr std::string_view illegal_chars = "IOQ";
+    //  Model year codes repeat every 30 years: A is 1980 and 2010, 9 is 2009 and 2039
+    inline constexpr std::string_view year_codes = "ABCDEFGHJKLMNPRSTVWXY123456789";
+    inline constexpr int first_year_cycle = 1980;
+    inline constexpr int year_cycle = 30;
+
+    //  Classes of the symbols, every check of the VIN is a lookup in the symbol_classes table
+    enum SymbolClass : std::uint8_t {
+        SYMBOL_LEGAL = 1,           // Digit or capital latin letter
+        SYMBOL_IOQ = 2,             // I, O and Q look like digits and are not used
+        SYMBOL_CHECK_DIGIT = 4      // Digit or X
+    };
+
+    [[nodiscard]] constexpr std::array<std::uint8_t, 256> makeSymbolClasses() noexcept
+    {
+        std::array<std::uint8_t, 256> classes = {};
+        for (int symbol = '0'; symbol <= '9'; ++symbol)
+            classes[symbol] = SYMBOL_LEGAL | SYMBOL_CHECK_DIGIT;
+        for (int symbol = 'A'; symbol <= 'Z'; ++symbol)
+            classes[symbol] = SYMBOL_LEGAL;
+        for (const char symbol : illegal_chars)
+            classes[static_cast<unsigned char>(symbol)] |= SYMBOL_IOQ;
+        classes['X'] |= SYMBOL_CHECK_DIGIT;
+        return classes;
+    }
+    //  Position of the model year code in year_codes or -1
+    [[nodiscard]] constexpr std::array<std::int8_t, 256> makeYearCodes() noexcept
+    {
+        std::array<std::int8_t, 256> positions = {};
+        for (auto &position : positions)
+            position = -1;
+        for (std::size_t i = 0; i < year_codes.size(); ++i)
+            positions[static_cast<unsigned char>(year_codes[i])] = static_cast<std::int8_t>(i);
+        return positions;
+    }
+
+    namespace checkSum {
+        //  Returns char ID based on checksum table for symbols
+        [[nodiscard]] constexpr int getCharId(const char sym) noexcept
+        {
+            int char_id = 0;
+            if (sym <= 'H')
+                char_id = sym - 'A' + 1;
+            else if (sym >= 'J' && sym <= 'R')
+                char_id = sym - 'H' - 1;
+            else if (sym >= 'S' && sym <= 'Z')
+                char_id = sym - 'R' + 1;
+            return char_id;
+        }
+        //  Returns weight of the symbol based on his position (1-based)
+        [[nodiscard]] constexpr int getWeight(const std::size_t position) noexcept
+        {
+            int weight = 0;
+            if (position < 8) {
+                weight = 8;
+                for (std::size_t i = 1; i < position; ++i)
+                    --weight;
+            } else if (position == 8) {
+                weight = 10;
+            } else if (position >= 10) {
+                weight = 9;
+                for (std::size_t i = 10; i < position; ++i)
+                    --weight;
+            }
+            return weight;
+        }
+        //  Transliteration of the symbols to the numbers, symbols that can't be in a valid VIN are 0
+        [[nodiscard]] constexpr std::array<std::uint8_t, 256> makeSymbolValues() noexcept
+        {
+            std::array<std::uint8_t, 256> values = {};
+            for (int symbol = '0'; symbol <= '9'; ++symbol)
+                values[symbol] = static_cast<std::uint8_t>(symbol - '0');
+            for (int symbol = 'A'; symbol <= 'Z'; ++symbol)
+                values[symbol] = static_cast<std::uint8_t>(getCharId(static_cast<char>(symbol)));
+            return values;
+        }
+        //  Weights by the position in VIN, the check digit itself has zero weight
+        [[nodiscard]] constexpr std::array<std::uint8_t, vin_size> makeWeights() noexcept
+        {
+            std::array<std::uint8_t, vin_size> weights = {};
+            for (std::size_t i = 0; i < vin_size; ++i)
+                weights[i] = static_cast<std::uint8_t>(getWeight(i + 1));
+            return weights;
+        }
+    }
+
+    inline constexpr std::array<std::uint8_t, 256> symbol_classes = makeSymbolClasses();
+    inline constexpr std::array<std::int8_t, 256> year_code_positions = makeYearCodes();
+    namespace checkSum {
+        inline constexpr std::array<std::uint8_t, 256> symbol_values = makeSymbolValues();
+        inline constexpr std::array<std::uint8_t, vin_size> weights = makeWeights();
+    }
+    static_assert(checkSum::weights[0] == 8 && checkSum::weights[7] == 10 && checkSum::weights[8] == 0
+                  && checkSum::weights[9] == 9 && checkSum::weights[16] == 2);
+    static_assert(checkSum::symbol_values['A'] == 1 && checkSum::symbol_values['J'] == 1
+                  && checkSum::symbol_values['S'] == 2 && checkSum::symbol_values['Z'] == 9);
+    static_assert(symbol_classes['O'] == (SYMBOL_LEGAL | SYMBOL_IOQ) && symbol_classes['a'] == 0);
+    static_assert(year_code_positions['A'] == 0 && year_code_positions['9'] == 29 && year_code_positions['I'] < 0);
+
+    [[nodiscard]] constexpr std::uint8_t getSymbolClass(char symbol) noexcept
+    {
+        return symbol_classes[static_cast<unsigned char>(symbol)];
+    }
+
+    namespace checkSum {
+        //  Remainder of the weighted sum, the VIN must have vin_size symbols
+        [[nodiscard]] constexpr int calculateCheckSum(std::string_view vin) noexcept
+        {
+            int vin_sum = 0;
+            for (std::size_t i = 0; i < vin_size; ++i)
+                vin_sum += symbol_values[static_cast<unsigned char>(vin[i])] * weights[i];
+            return vin_sum % 11;
+        }
+        //  Remainder 10 is written as 'X'
+        [[nodiscard]] constexpr int getCheckDigitValue(char symbol) noexcept
+        {
+            return symbol == 'X' ? 10 : symbol - '0';
+        }
+        [[nodiscard]] constexpr bool matchesCheckDigit(std::string_view vin) noexcept
+        {
+            return calculateCheckSum(vin) == getCheckDigitValue(vin[check_digit_position]);
+        }
+    }
+
+    //  Symbol checks of a VIN with vin_size symbols. Symbol classes are accumulated over the whole VIN
+    //  without branches, the error is chosen at the end
+    [[nodiscard]] constexpr VINError findSymbolsError(std::string_view vin) noexcept
+    {
+        std::uint8_t all = SYMBOL_LEGAL;
+        std::uint8_t any = 0;
+        for (std::size_t i = 0; i < vin_size; ++i) {
+            const std::uint8_t symbol_class = getSymbolClass(vin[i]);
+            all &= symbol_class;
+            any |= symbol_class;
+        }
+        if (!(getSymbolClass(vin[check_digit_position]) & SYMBOL_CHECK_DIGIT))
+            return VINError::INVALID_CHECK_DIGIT_SYMBOL;
+        if (!(all & SYMBOL_LEGAL))
+            return VINError::ILLEGAL_SYMBOLS;
+        if (any & SYMBOL_IOQ)
+            return VINError::ILLEGAL_IOQ_SYMBOLS;
+        return VINError::NONE;
+    }
+    //  Same checks as validateVIN, without the metrics
+    [[nodiscard]] constexpr VINError findVINError(std::string_view vin) noexcept
+    {
+        if (vin.size() != vin_size)
+            return VINError::INVALID_SIZE;
+        const VINError symbols_error = findSymbolsError(vin);
+        if (symbols_error != VINError::NONE)
+            return symbols_error;
+        if (!checkSum::matchesCheckDigit(vin))
+            return VINError::INVALID_CHECKSUM;
+        return VINError::NONE;
+    }
+    [[nodiscard]] constexpr bool isVINValid(std::string_view vin) noexcept
+    {
+        return findVINError(vin) == VINError::NONE;
+    }
+    //  Returns the check digit ('0'..'9' or 'X') for the VIN number, the current check digit (position 9)
+    //  is ignored. VIN must have the right size and legal symbols, otherwise 0 is returned
+    [[nodiscard]] constexpr char getCheckDigit(std::string_view vin) noexcept
+    {
+        if (vin.size() != vin_size)
+            return 0;
+        for (std::size_t i = 0; i < vin_size; ++i) {
+            if (i != check_digit_position && (getSymbolClass(vin[i]) & (SYMBOL_LEGAL | SYMBOL_IOQ)) != SYMBOL_LEGAL)
+                return 0;
+        }
+        const int check_sum = checkSum::calculateCheckSum(vin);
+        return check_sum == 10 ? 'X' : static_cast<char>('0' + check_sum);
+    }
+    //  Returns the model year of the vehicle from 1980 to 2039, if the year code is invalid - returns 0.
+    //  The year code (position 10) gives the year in the 30-year cycle, the cycle is chosen by position 7:
+    //  digit for 1980-2009, letter for 2010-2039
+    [[nodiscard]] constexpr int getModelYear(std::string_view vin) noexcept
+    {
+        if (vin.size() < 10)
+            return 0;
+        const int code_position = year_code_positions[static_cast<unsigned char>(vin[9])];
+        if (code_position < 0)
+            return 0;
+        return first_year_cycle + code_position + (vin[6] >= 'A' && vin[6] <= 'Z' ? year_cycle : 0);
+    }
+
+    static_assert(findVINError("1HGCM82633A004352") == VINError::NONE && isVINValid("11111111111111111"));
+    static_assert(findVINError("1HGCM82633A004353") == VINError::INVALID_CHECKSUM);
+    static_assert(findVINError("1HGCM8263IA004352") == VINError::ILLEGAL_IOQ_SYMBOLS && findVINError("1HGCM82633") == VINError::INVALID_SIZE);
+    static_assert(getCheckDigit("1HGCM82603A004352") == '3' && getModelYear("1HGCM82633A004352") == 2003);
+}
@@ -0,0 +1,931 @@
+//Differential test: every fast path must give exactly the same result as the reference implementation.
+//  VIN:  validateVIN is the reference for checkVIN, decode, DecodeCache and every checkVINBatch kernel,
+//        trying every single-symbol substitution is the reference for findCorrections
+//  Mark: the original a999aa999 validator (number 000 rejected) is the reference for ValidateMark, ValidateMark
+//        for CheckMark and Mark::Parse, a plain string odometer for Mark::Next, GetNextMarkAfter
+//        and the integer arithmetic
+//  Plate: every PlateFormat must format, parse and encode its plates back to the same parts
+//  Pipeline: the rows of the staged pipeline must be the rows of processStream, in any order, the corrections
+//            column must list the corrections of the reference
+//  Index: a full scan of the corpus is the reference for every index query
+//  Inventory: a plain array of issued flags with prefix sums is the reference for PlateInventory
+//  C interface: every batch function of vin_analyzer.h must give the results of the C++ functions
+//  Metrics: with VIN_METRICS every line of processStream and the pipeline is counted once, internal
+//           validations are not counted
+//Corpora are generated from the seed, files given on the command line are checked as well.
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include "corpus.hpp"
+#include "index.hpp"
+#include "metrics.hpp"
+#include "pipeline.hpp"
+#include "plate_format.hpp"
+#include "plate_inventory.hpp"
+#include "reg_mark.hpp"
+#include "ring_buffer.hpp"
+#include "vin.hpp"
+#include "vin_analyzer.h"
+#include "vin_cache.hpp"
+
+namespace {
+    const std::size_t max_reported_mismatches = 20;
+    const std::string_view series_symbols = "ABCEHKMOPTXY";
+
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int symbol) override { return symbol; }
+    };
+
+    class Checker {
+    public:
+        void expect(bool condition, const char *check, std::string_view item)
+        {
+            ++checks;
+            if (condition)
+                return;
+            if (++mismatches <= max_reported_mismatches)
+                std::cout << "Mismatch in " << check << " for \"" << item << "\"\n";
+        }
+        [[nodiscard]] std::size_t getChecks() const noexcept { return checks; }
+        [[nodiscard]] std::size_t getMismatches() const noexcept { return mismatches; }
+    private:
+        std::size_t checks = 0;
+        std::size_t mismatches = 0;
+    };
+
+    [[nodiscard]] bool isUniqueRegion(int region)
+    {
+        return std::find(RegMark::unique_region_codes.begin(), RegMark::unique_region_codes.end(),
+                         static_cast<unsigned int>(region)) != RegMark::unique_region_codes.end();
+    }
+
+    // Reference validator: the original checks of the a999aa999 format and number 000, a999aa99 is checked as a999aa990
+    [[nodiscard]] RegMark::MarkError validateMarkReference(std::string mark)
+    {
+        if (mark.size() == 8)
+            mark += '0';
+        if (mark.size() != 9)
+            return RegMark::MarkError::INVALID_SIZE;
+        for (const auto symbol : mark) {
+            if (!std::isalnum(static_cast<unsigned char>(symbol)))
+                return RegMark::MarkError::ILLEGAL_SYMBOLS;
+        }
+        if (mark.find_first_of("DFGIJLNQRSUVWZ") != std::string::npos)
+            return RegMark::MarkError::ILLEGAL_LATIN_SYMBOLS;
+        for (const std::size_t position : {1, 2, 3, 6, 7, 8}) {
+            if (!std::isdigit(static_cast<unsigned char>(mark[position])))
+                return RegMark::MarkError::INVALID_DIGITS;
+        }
+        if (mark.compare(1, 3, "000") == 0)
+            return RegMark::MarkError::INVALID_DIGITS;
+        for (const std::size_t position : {0, 4, 5}) {
+            if (!std::isupper(static_cast<unsigned char>(mark[position])))
+                return RegMark::MarkError::INVALID_SERIES;
+        }
+        int region = std::stoi(mark.substr(6));
+        if (mark[8] == '0' && !isUniqueRegion(region))
+            region = mark[6] == '0' ? mark[7] - '0' : std::stoi(mark.substr(6, 2));
+        return (region >= 1 && region <= 99) || isUniqueRegion(region) ? RegMark::MarkError::NONE : RegMark::MarkError::INVALID_REGION;
+    }
+
+    // Reference successor: increments the number, on overflow increments the series
+    // letters from the last one like an odometer
+    [[nodiscard]] std::string getNextMarkReference(std::string mark)
+    {
+        int number = std::stoi(mark.substr(1, 3)) + 1;
+        if (number == 1000) {
+            number = 1;
+            for (const std::size_t position : {5, 4, 0}) {
+                const std::size_t index = series_symbols.find(mark[position]);
+                if (index + 1 < series_symbols.size()) {
+                    mark[position] = series_symbols[index + 1];
+                    break;
+                }
+                mark[position] = series_symbols[0];
+            }
+        }
+        const std::string digits = std::to_string(number);
+        mark.replace(1, 3, std::string(3 - digits.size(), '0') + digits);
+        return mark;
+    }
+
+    // Reference order: region, then series letters 1, 5 and 6 in the order of series_symbols, then number
+    [[nodiscard]] std::array<int, 5> getMarkOrderReference(const std::string &mark, RegMark::Mark parsed)
+    {
+        return {static_cast<int>(parsed.Region()), static_cast<int>(series_symbols.find(mark[0])),
+                static_cast<int>(series_symbols.find(mark[4])), static_cast<int>(series_symbols.find(mark[5])),
+                std::stoi(mark.substr(1, 3))};
+    }
+
+    [[nodiscard]] bool isSameDecode(const VIN::DecodedVIN &first, const VIN::DecodedVIN &second) noexcept
+    {
+        return first.wmi == second.wmi && first.vds == second.vds && first.plant == second.plant && first.serial == second.serial
+            && first.model_year == second.model_year && first.country == second.country && first.error == second.error;
+    }
+
+    // Reference corrections: every legal symbol at every position, in the order of positions
+    [[nodiscard]] std::vector<std::pair<std::size_t, char>> findCorrectionsReference(const std::string &vin)
+    {
+        std::vector<std::pair<std::size_t, char>> corrections;
+        if (VIN::validateVIN(vin) == VIN::VINError::NONE)
+            return corrections;
+        const std::string_view symbols = "0123456789ABCDEFGHJKLMNPRSTUVWXYZ";
+        for (std::size_t position = 0; position < vin.size() && vin.size() == 17; ++position) {
+            for (const char symbol : symbols) {
+                std::string corrected = vin;
+                corrected[position] = symbol;
+                if (symbol != vin[position] && VIN::validateVIN(corrected) == VIN::VINError::NONE)
+                    corrections.emplace_back(position, symbol);
+            }
+        }
+        std::sort(corrections.begin(), corrections.end());
+        return corrections;
+    }
+
+    // Scanned form of a valid VIN: lowercase letters, O or Q instead of 0, I instead of 1, dashes and spaces
+    [[nodiscard]] std::string getScannedVIN(const std::string &vin, std::size_t seed)
+    {
+        std::string scanned;
+        for (std::size_t i = 0; i < vin.size(); ++i) {
+            const std::size_t choice = (seed + i * 7) % 5;
+            char symbol = vin[i];
+            if (symbol == '0' && choice < 2)
+                symbol = choice == 0 ? 'O' : 'q';
+            else if (symbol == '1' && choice < 2)
+                symbol = choice == 0 ? 'I' : 'i';
+            else if (choice == 2)
+                symbol = static_cast<char>(std::tolower(static_cast<unsigned char>(symbol)));
+            scanned += symbol;
+            if (choice == 3 && i % 4 == 3)
+                scanned += i % 8 == 3 ? '-' : ' ';
+        }
+        return scanned;
+    }
+
+    // The batch functions of the C interface over the 17-byte records of checkVINs
+    void checkVINInterface(Checker &checker, const std::string &records, const std::vector<bool> &expected_valid)
+    {
+        const std::size_t count = expected_valid.size();
+        const std::size_t valid = static_cast<std::size_t>(std::count(expected_valid.begin(), expected_valid.end(), true));
+        // Stale bits must be cleared by vin_check_batch
+        std::vector<std::uint64_t> bitmap((count + 63) / 64, ~std::uint64_t{0});
+        std::vector<std::uint8_t> errors(count);
+        std::vector<vin_decoded> decoded(count);
+        checker.expect(vin_check_batch(records.data(), count, bitmap.data()) == valid, "vin_check_batch count", "");
+        checker.expect(vin_validate_batch(records.data(), count, errors.data()) == valid, "vin_validate_batch count", "");
+        checker.expect(vin_decode_batch(records.data(), count, decoded.data()) == valid, "vin_decode_batch count", "");
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::string_view vin = std::string_view(records).substr(i * VIN_RECORD_SIZE, VIN_RECORD_SIZE);
+            const VIN::DecodedVIN reference = VIN::decode(vin);
+            checker.expect(((bitmap[i / 64] >> (i % 64)) & 1) == expected_valid[i], "vin_check_batch", vin);
+            checker.expect(errors[i] == static_cast<std::uint8_t>(reference.error), "vin_validate_batch", vin);
+            checker.expect(vin_validate(vin.data(), vin.size()) == static_cast<int>(reference.error), "vin_validate", vin);
+            checker.expect(std::string_view(decoded[i].wmi, 3) == std::string_view(reference.wmi.data(), 3)
+                               && std::string_view(decoded[i].vds, 5) == std::string_view(reference.vds.data(), 5)
+                               && decoded[i].plant == reference.plant
+                               && std::string_view(decoded[i].serial, 6) == std::string_view(reference.serial.data(), 6)
+                               && decoded[i].model_year == reference.model_year && decoded[i].country == reference.country
+                               && decoded[i].error == static_cast<std::uint8_t>(reference.error),
+                           "vin_decode_batch", vin);
+            checker.expect(VIN::getCountryName(reference.country) == vin_country_name(decoded[i].country), "vin_country_name", vin);
+        }
+    }
+
+    // Marks of the given size go through the C interface as records and are formatted back
+    void checkMarkInterface(Checker &checker, const std::vector<std::string> &marks, std::size_t record_size)
+    {
+        std::string records;
+        for (const auto &mark : marks) {
+            if (mark.size() == record_size)
+                records += mark;
+        }
+        const std::size_t count = records.size() / record_size;
+        std::vector<std::uint8_t> errors(count);
+        std::vector<std::uint32_t> values(count);
+        std::string formatted(count * VIN_MARK_RECORD_SIZE, ' ');
+        const std::size_t valid = vin_mark_validate_batch(records.data(), record_size, count, errors.data());
+        const std::size_t encoded = vin_mark_encode_batch(records.data(), record_size, count, values.data());
+        checker.expect(vin_mark_format_batch(values.data(), count, formatted.data()) == encoded, "vin_mark_format_batch count", "");
+        std::size_t expected_valid = 0;
+        std::size_t expected_encoded = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::string_view mark = std::string_view(records).substr(i * record_size, record_size);
+            const RegMark::MarkError reference = RegMark::ValidateMark(mark);
+            const std::optional<RegMark::Mark> parsed = RegMark::Mark::Parse(mark);
+            expected_valid += reference == RegMark::MarkError::NONE;
+            expected_encoded += parsed.has_value();
+            checker.expect(errors[i] == static_cast<std::uint8_t>(reference), "vin_mark_validate_batch", mark);
+            checker.expect(vin_mark_validate(mark.data(), mark.size()) == static_cast<int>(reference), "vin_mark_validate", mark);
+            checker.expect(values[i] == (parsed ? parsed->Value() : VIN_MARK_INVALID), "vin_mark_encode_batch", mark);
+            const std::string_view record = std::string_view(formatted).substr(i * VIN_MARK_RECORD_SIZE, VIN_MARK_RECORD_SIZE);
+            checker.expect(parsed ? record == parsed->Format() : record == std::string_view("\0\0\0\0\0\0\0\0\0", 9),
+                           "vin_mark_format_batch", mark);
+        }
+        checker.expect(valid == expected_valid, "vin_mark_validate_batch count", "");
+        checker.expect(encoded == expected_encoded, "vin_mark_encode_batch count", "");
+    }
+
+    void checkVINs(Checker &checker, const std::vector<std::string> &vins)
+    {
+        // Small cache, so the VIN numbers are evicted and decoded again
+        VIN::DecodeCache cache(256, 4);
+        std::string records;
+        std::vector<bool> expected_valid;
+        for (const auto &vin : vins) {
+            const VIN::VINError reference = VIN::validateVIN(vin);
+            checker.expect(VIN::checkVIN(vin) == (reference == VIN::VINError::NONE), "checkVIN", vin);
+            checker.expect(VIN::findVINError(vin) == reference, "findVINError", vin);
+
+            const VIN::DecodedVIN decoded = VIN::decode(vin);
+            checker.expect(decoded.error == reference, "decode error", vin);
+            checker.expect(isSameDecode(cache.Decode(vin), decoded), "DecodeCache miss", vin);
+            checker.expect(isSameDecode(cache.Decode(vin), decoded), "DecodeCache hit", vin);
+            if (reference != VIN::VINError::INVALID_SIZE) {
+                checker.expect(decoded.country == VIN::getVINCountryId(vin), "decode country", vin);
+                checker.expect(VIN::getCountryName(decoded.country) == VIN::getVINCountry(vin), "getVINCountry", vin);
+                checker.expect(decoded.model_year == VIN::getTransportYear(vin), "decode model year", vin);
+                checker.expect(std::string_view(decoded.wmi.data(), 3) == std::string_view(vin).substr(0, 3), "decode wmi", vin);
+                checker.expect(std::string_view(decoded.serial.data(), 6) == std::string_view(vin).substr(11), "decode serial", vin);
+
+                records += vin;
+                expected_valid.push_back(reference == VIN::VINError::NONE);
+            }
+            if (reference == VIN::VINError::NONE) {
+                std::string scanned = getScannedVIN(vin, records.size());
+                VIN::normalizeVIN(scanned);
+                checker.expect(scanned == vin, "normalizeVIN", vin);
+            }
+        }
+        // Brute force is slow, so only a part of the corpus is corrected
+        for (std::size_t i = 0; i < vins.size(); i += 37) {
+            const VIN::VINCorrections corrections = VIN::findCorrections(vins[i]);
+            std::vector<std::pair<std::size_t, char>> found;
+            for (std::size_t j = 0; j < corrections.count; ++j)
+                found.emplace_back(corrections.items[j].position, corrections.items[j].symbol);
+            std::sort(found.begin(), found.end());
+            checker.expect(found == findCorrectionsReference(vins[i]), "findCorrections", vins[i]);
+        }
+
+        const std::size_t count = expected_valid.size();
+        for (const auto kernel : {VIN::BatchKernel::SCALAR, VIN::BatchKernel::SSSE3, VIN::BatchKernel::AVX2, VIN::BatchKernel::AUTO}) {
+            const std::vector<std::uint64_t> bitmap = VIN::checkVINBatch(records.data(), count, kernel);
+            for (std::size_t i = 0; i < count; ++i) {
+                const bool valid = (bitmap[i / 64] >> (i % 64)) & 1;
+                checker.expect(valid == expected_valid[i], "checkVINBatch", std::string_view(records).substr(i * 17, 17));
+            }
+        }
+        checkVINInterface(checker, records, expected_valid);
+    }
+
+    void checkMarks(Checker &checker, const std::vector<std::string> &marks)
+    {
+        std::string previous;
+        for (const auto &item : marks) {
+            const RegMark::MarkError reference = RegMark::ValidateMark(item);
+            checker.expect(reference == validateMarkReference(item), "ValidateMark", item);
+            checker.expect(RegMark::CheckMark(item) == (reference == RegMark::MarkError::NONE), "CheckMark", item);
+            checker.expect(RegMark::ValidatePlate(item) == reference || RegMark::DetectPlateKind(item) != RegMark::PlateKind::PRIVATE,
+                           "ValidatePlate", item);
+            // The short form is the same mark, it is always formatted in 9 symbols: dd0, or 0dd if dd0 is a three digit region
+            std::string mark = item;
+            if (item.size() == 8)
+                mark = isUniqueRegion(std::atoi(item.substr(6).c_str()) * 10) ? item.substr(0, 6) + '0' + item.substr(6) : item + '0';
+
+            const std::optional<RegMark::Mark> parsed = RegMark::Mark::Parse(item);
+            checker.expect(parsed.has_value() == (reference == RegMark::MarkError::NONE), "Mark::Parse", mark);
+            if (!parsed)
+                continue;
+
+            checker.expect(parsed->Format() == mark, "Mark::Format", mark);
+            const std::string next = getNextMarkReference(mark);
+            checker.expect(parsed->Next().Format() == next, "Mark::Next", mark);
+            checker.expect(RegMark::GetNextMarkAfter(mark) == next, "GetNextMarkAfter", mark);
+            checker.expect(parsed->Next().Previous() == *parsed, "Mark::Previous", mark);
+
+            RegMark::Mark stepped = *parsed;
+            std::string stepped_reference = mark;
+            for (int step = 1; step <= 3; ++step) {
+                stepped = stepped.Next();
+                stepped_reference = getNextMarkReference(stepped_reference);
+                checker.expect(parsed->Add(step) == stepped, "Mark::Add", mark);
+                checker.expect(stepped.Add(-step) == *parsed, "Mark::Add negative", mark);
+                checker.expect(stepped.Difference(*parsed) == step || stepped.Position() < parsed->Position(), "Mark::Difference", mark);
+            }
+            checker.expect(stepped.Format() == stepped_reference, "Mark::Next chain", mark);
+
+            // Ordering against the previous valid mark of the corpus
+            if (!previous.empty()) {
+                const RegMark::Mark other = *RegMark::Mark::Parse(previous);
+                const auto reference = getMarkOrderReference(mark, *parsed) <=> getMarkOrderReference(previous, other);
+                checker.expect((*parsed <=> other) == reference, "Mark::operator<=>", mark);
+                // Range check of GetNextMarkAfterRange, the mark after the first one may be outside the range
+                const RegMark::Mark first = reference < 0 ? *parsed : other;
+                const RegMark::Mark last = reference < 0 ? other : *parsed;
+                const RegMark::Mark middle = first.Add(1);
+                std::string expected(RegMark::out_of_stock);
+                if (middle == last)
+                    expected = middle.Format();
+                else if (first < middle && middle < last)
+                    expected = middle.Next().Format();
+                checker.expect(RegMark::GetNextMarkAfterRange(middle.Format(), first.Format(), last.Format()) == expected,
+                               "GetNextMarkAfterRange", mark);
+            }
+            previous = mark;
+        }
+        checkMarkInterface(checker, marks, 9);
+        checkMarkInterface(checker, marks, 8);
+    }
+
+    // Random parts of every format go through FormatTo, Parse, Encode and Decode
+    template <typename Format>
+    void checkPlateFormat(Checker &checker, std::mt19937_64 &random, std::size_t count, RegMark::PlateKind kind)
+    {
+        // The last plates have the regions that share the padded form with another region
+        const std::array<std::uint32_t, 8> boundary_regions = {190, 19, 750, 75, 150, 15, 50, 5};
+        std::string plate(Format::size, ' ');
+        for (std::size_t i = 0; i < count + boundary_regions.size(); ++i) {
+            RegMark::PlateParts parts = {static_cast<std::uint32_t>(random() % Format::series_count),
+                                         static_cast<std::uint32_t>(1 + random() % Format::max_number),
+                                         static_cast<std::uint32_t>(1 + random() % 99)};
+            if (random() % 4 == 0)
+                parts.region = RegMark::unique_region_codes[random() % RegMark::max_unique_codes];
+            if (i >= count)
+                parts.region = boundary_regions[i - count];
+            if (Format::region_digits < 3 && parts.region > Format::max_region)
+                parts.region %= 100;
+            if (parts.region == 0)
+                parts.region = 77;
+            Format::FormatTo(parts, plate.data());
+            const std::optional<RegMark::PlateParts> parsed = Format::Parse(plate);
+            checker.expect(parsed && parsed->series == parts.series && parsed->number == parts.number && parsed->region == parts.region,
+                           "PlateFormat::Parse", plate);
+            const RegMark::PlateParts decoded = Format::Decode(Format::Encode(parts));
+            checker.expect(decoded.series == parts.series && decoded.number == parts.number && decoded.region == parts.region,
+                           "PlateFormat::Decode", plate);
+            checker.expect(RegMark::ValidatePlate(plate) == RegMark::MarkError::NONE, "ValidatePlate", plate);
+            checker.expect(RegMark::DetectPlateKind(plate) == kind, "DetectPlateKind", plate);
+            const std::optional<RegMark::EncodedPlate> encoded = RegMark::EncodePlate(plate);
+            checker.expect(encoded && encoded->kind == kind, "EncodePlate", plate);
+            if (kind == RegMark::PlateKind::PRIVATE)
+                checker.expect(encoded && encoded->value == RegMark::Mark::Parse(plate)->Value(), "EncodePlate private", plate);
+        }
+    }
+
+    void checkPlates(Checker &checker, std::uint64_t seed, std::size_t count)
+    {
+        std::mt19937_64 random(seed);
+        checkPlateFormat<RegMark::PrivateFormat>(checker, random, count, RegMark::PlateKind::PRIVATE);
+        checkPlateFormat<RegMark::PrivateShortFormat>(checker, random, count, RegMark::PlateKind::PRIVATE);
+        checkPlateFormat<RegMark::TrailerFormat>(checker, random, count, RegMark::PlateKind::TRAILER);
+        checkPlateFormat<RegMark::TaxiFormat>(checker, random, count, RegMark::PlateKind::TAXI);
+        for (const std::string_view plate : {"AB1234770", "AB12377X", "A12345BC", "AB1234", "A123BC7"})
+            checker.expect(RegMark::ValidatePlate(plate) != RegMark::MarkError::NONE, "ValidatePlate invalid", plate);
+    }
+
+    // Every query is compared with the rows found by a full scan
+    void checkVINIndex(Checker &checker, const std::vector<std::string> &vins, Batch::ThreadPool &pool)
+    {
+        const Index::VINIndex index = Index::VINIndex::Build(vins, pool);
+        std::vector<VIN::DecodedVIN> decoded;
+        for (const auto &vin : vins)
+            decoded.push_back(VIN::decode(vin));
+        // Model year 0 is a valid query (unknown year), so -1 means any year
+        const auto scan = [&vins, &decoded](std::string_view prefix, int model_year) {
+            std::vector<std::uint64_t> rows;
+            for (std::size_t row = 0; row < vins.size(); ++row) {
+                if (decoded[row].valid() && vins[row].compare(0, prefix.size(), prefix) == 0
+                    && (model_year < 0 || decoded[row].model_year == model_year))
+                    rows.push_back(row);
+            }
+            return rows;
+        };
+        const auto rowsOf = [](Index::Range<Index::VINEntry> range) {
+            std::vector<std::uint64_t> rows;
+            for (const auto &entry : range)
+                rows.push_back(entry.row);
+            std::sort(rows.begin(), rows.end());
+            return rows;
+        };
+        for (std::size_t row = 0; row < vins.size(); row += 211) {
+            const std::string &vin = vins[row];
+            checker.expect(rowsOf(index.Find(vin)) == scan(vin.size() == 17 ? vin : "-", -1), "VINIndex::Find", vin);
+            if (!decoded[row].valid())
+                continue;
+            checker.expect(index.Find(vin).first->Format() == vin, "VINEntry::Format", vin);
+            checker.expect(rowsOf(index.FindPrefix(vin.substr(0, 3))) == scan(vin.substr(0, 3), -1), "VINIndex::FindPrefix WMI", vin);
+            checker.expect(rowsOf(index.FindPrefix(vin.substr(0, 5))) == scan(vin.substr(0, 5), -1), "VINIndex::FindPrefix VDS", vin);
+            std::vector<std::uint64_t> rows = index.FindByWMIAndYear(vin.substr(0, 3), VIN::getTransportYear(vin));
+            checker.expect(std::is_sorted(rows.begin(), rows.end(), [&vins](std::uint64_t first, std::uint64_t second) {
+                return vins[first] < vins[second];
+            }), "VINIndex::FindByWMIAndYear order", vin);
+            std::sort(rows.begin(), rows.end());
+            checker.expect(rows == scan(vin.substr(0, 3), VIN::getTransportYear(vin)), "VINIndex::FindByWMIAndYear", vin);
+        }
+    }
+
+    void checkMarkIndex(Checker &checker, const std::vector<std::string> &marks, Batch::ThreadPool &pool)
+    {
+        const Index::MarkIndex index = Index::MarkIndex::Build(marks, pool);
+        std::vector<std::optional<RegMark::Mark>> parsed;
+        for (const auto &mark : marks)
+            parsed.push_back(RegMark::Mark::Parse(mark));
+        checker.expect(std::is_sorted(index.Entries().begin(), index.Entries().end(), [](const Index::MarkEntry &first, const Index::MarkEntry &second) {
+            return first.mark.Value() < second.mark.Value();
+        }), "MarkIndex order", "");
+        for (std::size_t row = 0; row + 1 < marks.size(); row += 211) {
+            if (!parsed[row] || !parsed[row + 1])
+                continue;
+            const RegMark::Mark first = parsed[row]->Value() < parsed[row + 1]->Value() ? *parsed[row] : *parsed[row + 1];
+            const RegMark::Mark last = parsed[row]->Value() < parsed[row + 1]->Value() ? *parsed[row + 1] : *parsed[row];
+            const std::uint32_t last_series = std::min(first.Series() + 5, RegMark::Mark::series_count - 1);
+            std::size_t exact = 0;
+            std::size_t in_range = 0;
+            std::size_t in_series = 0;
+            for (const auto &mark : parsed) {
+                exact += mark && *mark == first;
+                in_range += mark && mark->Value() >= first.Value() && mark->Value() <= last.Value();
+                in_series += mark && mark->Region() == first.Region() && mark->Series() >= first.Series() && mark->Series() <= last_series;
+            }
+            checker.expect(index.Find(first).size() == exact, "MarkIndex::Find", marks[row]);
+            checker.expect(index.FindRange(first, last).size() == in_range, "MarkIndex::FindRange", marks[row]);
+            checker.expect(index.FindSeriesRange(first.Region(), first.Series(), last_series).size() == in_series, "MarkIndex::FindSeriesRange", marks[row]);
+        }
+    }
+
+    class StringSink : public Batch::Sink {
+    public:
+        [[nodiscard]] bool Write(std::string_view rows) override
+        {
+            text += rows;
+            return true;
+        }
+        std::string text;
+    };
+
+    [[nodiscard]] std::vector<std::string> splitRows(std::string_view text)
+    {
+        std::vector<std::string> rows;
+        while (!text.empty()) {
+            const std::size_t row_end = text.find('\n');
+            rows.emplace_back(text.substr(0, row_end));
+            text.remove_prefix(row_end == std::string_view::npos ? text.size() : row_end + 1);
+        }
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    }
+
+    // Corrections column of a VIN row (the last one) as the pairs of findCorrectionsReference
+    [[nodiscard]] std::vector<std::pair<std::size_t, char>> parseCorrectionsColumn(std::string_view row)
+    {
+        std::vector<std::pair<std::size_t, char>> corrections;
+        std::string_view column = row.substr(row.rfind(',') + 1);
+        while (!column.empty()) {
+            const std::size_t item_end = std::min(column.find(' '), column.size());
+            const std::string_view item = column.substr(0, item_end);
+            corrections.emplace_back(std::strtoul(std::string(item).c_str(), nullptr, 10) - 1, item.back());
+            column.remove_prefix(std::min(item_end + 1, column.size()));
+        }
+        std::sort(corrections.begin(), corrections.end());
+        return corrections;
+    }
+
+    // Several producers submit blocks of the corpus, the sorted rows must match the rows of processChunk.
+    // The pipeline with 3 workers writes the VIN corrections
+    void checkPipeline(Checker &checker, const std::vector<std::string> &items, Batch::InputKind kind)
+    {
+        const bool corrections = kind == Batch::InputKind::VIN;
+        std::string expected;
+        std::string expected_corrected;
+        Batch::appendHeader(expected, kind, Batch::OutputFormat::CSV);
+        Batch::appendHeader(expected_corrected, kind, Batch::OutputFormat::CSV, corrections);
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            const std::string &item = items[i];
+            if (kind == Batch::InputKind::VIN) {
+                const VIN::DecodedVIN decoded = VIN::decode(item);
+                Batch::appendVINRow(expected, item, decoded, Batch::OutputFormat::CSV);
+                const std::size_t row_start = expected_corrected.size();
+                Batch::appendVINRow(expected_corrected, item, decoded, Batch::OutputFormat::CSV, corrections);
+                // Brute force is slow, so only a part of the rows is compared with the reference
+                if (i % 37 == 0) {
+                    const std::string_view row = std::string_view(expected_corrected).substr(row_start, expected_corrected.size() - row_start - 1);
+                    checker.expect(parseCorrectionsColumn(row) == findCorrectionsReference(item), "Corrections column", item);
+                }
+            } else {
+                const std::optional<RegMark::Mark> mark = RegMark::Mark::Parse(item);
+                Batch::appendMarkRow(expected, item, RegMark::ValidateMark(item), mark ? mark->Region() : 0, Batch::OutputFormat::CSV);
+            }
+        }
+        const std::vector<std::string> expected_rows = splitRows(expected);
+        const std::vector<std::string> expected_corrected_rows = splitRows(kind == Batch::InputKind::VIN ? expected_corrected : expected);
+
+        const std::size_t producers = 3;
+        for (const std::size_t workers : {1, 3}) {
+            Batch::PipelineOptions options;
+            options.kind = kind;
+            options.parse_workers = workers;
+            options.validate_workers = workers;
+            options.decode_workers = workers;
+            options.batch_size = 100;
+            options.queue_capacity = 4;
+            options.cache_capacity = workers == 1 ? 0 : 512;
+            options.corrections = workers != 1 && corrections;
+            StringSink sink;
+            Batch::Pipeline pipeline(options, sink);
+            std::vector<std::thread> threads;
+            for (std::size_t producer = 0; producer < producers; ++producer) {
+                threads.emplace_back([&pipeline, &items, producer] {
+                    std::string block;
+                    for (std::size_t i = producer; i < items.size(); i += producers) {
+                        block += items[i];
+                        block += '\n';
+                        if (block.size() > 3000) {
+                            pipeline.Submit(std::move(block));
+                            block.clear();
+                        }
+                    }
+                    pipeline.Submit(std::move(block));
+                });
+            }
+            for (auto &thread : threads)
+                thread.join();
+            checker.expect(pipeline.Finish() == static_cast<long long>(items.size()), "Pipeline::Finish", "");
+            checker.expect(splitRows(sink.text) == (options.corrections ? expected_corrected_rows : expected_rows), "Pipeline rows",
+                           kind == Batch::InputKind::VIN ? "VIN" : "mark");
+        }
+    }
+
+    // Change of every error counter between two snapshots
+    template <std::size_t Size>
+    [[nodiscard]] std::array<std::uint64_t, Size> getCounterChanges(const std::array<std::uint64_t, Size> &before,
+                                                                    const std::array<std::uint64_t, Size> &after)
+    {
+        std::array<std::uint64_t, Size> changes = {};
+        for (std::size_t i = 0; i < Size; ++i)
+            changes[i] = after[i] - before[i];
+        return changes;
+    }
+
+    void checkMetrics(Checker &checker)
+    {
+        Metrics::Snapshot before = Metrics::Collect();
+        if (!before.enabled)
+            return;
+        // Parsing, comparing and decoding validate internally, but count nothing
+        const std::vector<std::string> marks = {"D123AA77", "A123AF77", "A123AA77"};
+        for (const auto &mark : marks) {
+            checker.expect(RegMark::GetNextMarkAfterRange(mark, marks[2], "A125AA77") != mark || mark == marks[2], "GetNextMarkAfterRange", mark);
+            checker.expect(RegMark::GetCombinationCountInRange(mark, marks[2]) == (mark == marks[2]), "GetCombinationCountInRange", mark);
+        }
+        checker.expect(VIN::decode("1HGCM82633A004353").error == VIN::VINError::INVALID_CHECKSUM, "decode", "1HGCM82633A004353");
+        Metrics::Snapshot after = Metrics::Collect();
+        checker.expect(after.mark_errors == before.mark_errors && after.vin_errors == before.vin_errors, "Metrics of internal validations", "");
+
+        // Two rejected marks are two ILLEGAL_LATIN_SYMBOLS, not four
+        std::FILE *input = std::tmpfile();
+        std::FILE *output = std::tmpfile();
+        for (const auto &mark : marks)
+            std::fprintf(input, "%s\n", mark.c_str());
+        std::rewind(input);
+        Batch::Options options;
+        options.kind = Batch::InputKind::MARK;
+        options.threads = 2;
+        before = after;
+        checker.expect(Batch::processStream(fileno(input), output, options) == 3, "processStream", "marks");
+        after = Metrics::Collect();
+        std::array<std::uint64_t, Metrics::mark_error_count> mark_changes = {};
+        mark_changes[static_cast<std::size_t>(RegMark::MarkError::NONE)] = 1;
+        mark_changes[static_cast<std::size_t>(RegMark::MarkError::ILLEGAL_LATIN_SYMBOLS)] = 2;
+        checker.expect(getCounterChanges(before.mark_errors, after.mark_errors) == mark_changes, "Metrics of processStream", "marks");
+        std::fclose(input);
+        std::fclose(output);
+
+        // Cache hits and misses are counted like the uncached rows
+        const std::string vins = "1HGCM82633A004352\n1HGCM82633A004353\n1HGCM82633A004352\n1HGCM8263\n";
+        std::array<std::uint64_t, Metrics::vin_error_count> vin_changes = {};
+        vin_changes[static_cast<std::size_t>(VIN::VINError::NONE)] = 2;
+        vin_changes[static_cast<std::size_t>(VIN::VINError::INVALID_CHECKSUM)] = 1;
+        vin_changes[static_cast<std::size_t>(VIN::VINError::INVALID_SIZE)] = 1;
+        for (const std::size_t cache_capacity : {0, 16}) {
+            input = std::tmpfile();
+            output = std::tmpfile();
+            std::fputs(vins.c_str(), input);
+            std::rewind(input);
+            options.kind = Batch::InputKind::VIN;
+            options.cache_capacity = cache_capacity;
+            before = Metrics::Collect();
+            checker.expect(Batch::processStream(fileno(input), output, options) == 4, "processStream", "VIN");
+            after = Metrics::Collect();
+            checker.expect(getCounterChanges(before.vin_errors, after.vin_errors) == vin_changes, "Metrics of processStream", "VIN");
+            std::fclose(input);
+            std::fclose(output);
+
+            Batch::PipelineOptions pipeline_options;
+            pipeline_options.cache_capacity = cache_capacity;
+            StringSink sink;
+            Batch::Pipeline pipeline(pipeline_options, sink);
+            before = after;
+            pipeline.Submit(vins);
+            checker.expect(pipeline.Finish() == 4, "Pipeline::Finish", "VIN");
+            after = Metrics::Collect();
+            checker.expect(getCounterChanges(before.vin_errors, after.vin_errors) == vin_changes, "Metrics of Pipeline", "VIN");
+        }
+    }
+
+    // Every pushed value must be popped exactly once
+    void checkRingBuffers(Checker &checker)
+    {
+        const std::size_t values = 100000;
+        const std::size_t threads = 4;
+        Batch::MPMCRing<std::size_t> ring(64);
+        std::atomic<std::size_t> popped_sum{0};
+        std::atomic<std::size_t> popped_count{0};
+        std::vector<std::thread> workers;
+        for (std::size_t thread = 0; thread < threads; ++thread) {
+            workers.emplace_back([&ring, thread] {
+                for (std::size_t value = thread + 1; value <= values; value += threads) {
+                    std::size_t item = value;
+                    while (!ring.TryPush(item))
+                        std::this_thread::yield();
+                }
+            });
+            workers.emplace_back([&ring, &popped_sum, &popped_count] {
+                std::size_t item = 0;
+                while (popped_count.load() < values) {
+                    if (ring.TryPop(item)) {
+                        popped_sum += item;
+                        ++popped_count;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto &worker : workers)
+            worker.join();
+        checker.expect(popped_sum == values * (values + 1) / 2, "MPMCRing", "");
+
+        Batch::SPSCRing<std::size_t> spsc(16);
+        std::size_t spsc_sum = 0;
+        std::thread producer([&spsc] {
+            for (std::size_t value = 1; value <= values; ++value) {
+                std::size_t item = value;
+                while (!spsc.TryPush(item))
+                    std::this_thread::yield();
+            }
+        });
+        bool ordered = true;
+        for (std::size_t expected = 1; expected <= values;) {
+            std::size_t item = 0;
+            if (!spsc.TryPop(item)) {
+                std::this_thread::yield();
+                continue;
+            }
+            ordered = ordered && item == expected;
+            spsc_sum += item;
+            ++expected;
+        }
+        producer.join();
+        checker.expect(ordered && spsc_sum == values * (values + 1) / 2, "SPSCRing", "");
+    }
+
+    // Queries of random ranges against the reference flags of one region
+    void checkInventoryQueries(Checker &checker, const RegMark::PlateInventory &inventory, const std::vector<bool> &reference,
+                               std::uint32_t region, std::mt19937_64 &random, std::size_t count)
+    {
+        std::vector<std::uint32_t> issued_before(reference.size() + 1, 0);
+        for (std::size_t i = 0; i < reference.size(); ++i)
+            issued_before[i + 1] = issued_before[i] + reference[i];
+        checker.expect(inventory.CountIssued(region) == issued_before.back(), "PlateInventory::CountIssued", "");
+        for (std::size_t i = 0; i < count; ++i) {
+            // Most ranges stay around the dense part, so the bitmaps are searched as well
+            const std::uint32_t span = random() % 4 == 0 ? RegMark::Mark::marks_in_region : 300000;
+            std::uint32_t first = static_cast<std::uint32_t>(random() % span);
+            std::uint32_t last = static_cast<std::uint32_t>(random() % span);
+            if (first > last)
+                std::swap(first, last);
+            const std::uint32_t after = first + static_cast<std::uint32_t>(random() % (last - first + 1)) - (random() % 2 == 0 ? 0 : first);
+            const RegMark::Mark first_mark = RegMark::Mark::FromParts(region, first / 999, first % 999 + 1);
+            const RegMark::Mark last_mark = RegMark::Mark::FromParts(region, last / 999, last % 999 + 1);
+            const RegMark::Mark after_mark = RegMark::Mark::FromParts(region, after / 999, after % 999 + 1);
+
+            std::uint32_t expected = std::max(first, after + 1);
+            while (expected <= last && reference[expected])
+                ++expected;
+            const std::optional<RegMark::Mark> found = inventory.NextFree(after_mark, first_mark, last_mark);
+            checker.expect(expected <= last ? found && found->Position() == expected : !found, "PlateInventory::NextFree",
+                           after_mark.Format());
+            checker.expect(inventory.CountFree(first_mark, last_mark) == last - first + 1 - (issued_before[last + 1] - issued_before[first]),
+                           "PlateInventory::CountFree", first_mark.Format());
+            checker.expect(inventory.IsIssued(after_mark) == reference[after], "PlateInventory::IsIssued", after_mark.Format());
+        }
+    }
+
+    // Dense runs make bitmap containers, releasing them turns the containers back into arrays
+    void checkPlateInventory(Checker &checker, std::uint64_t seed, std::size_t count)
+    {
+        std::mt19937_64 random(seed);
+        const std::uint32_t region = 77;
+        std::vector<bool> reference(RegMark::Mark::marks_in_region, false);
+        RegMark::PlateInventory inventory;
+        const auto issue = [&](std::uint32_t position) {
+            const bool issued = inventory.Issue(RegMark::Mark::FromParts(region, position / 999, position % 999 + 1));
+            checker.expect(issued != reference[position], "PlateInventory::Issue", "");
+            reference[position] = true;
+        };
+        for (std::uint32_t position = 60000; position < 200000; ++position) {
+            if (random() % 1000 != 0)
+                issue(position);
+        }
+        for (std::size_t i = 0; i < count; ++i)
+            issue(static_cast<std::uint32_t>(random() % RegMark::Mark::marks_in_region));
+        checkInventoryQueries(checker, inventory, reference, region, random, count / 10);
+
+        for (std::uint32_t position = 60000; position < 140000; ++position) {
+            if (random() % 100 != 0) {
+                const bool released = inventory.Release(RegMark::Mark::FromParts(region, position / 999, position % 999 + 1));
+                checker.expect(released == reference[position], "PlateInventory::Release", "");
+                reference[position] = false;
+            }
+        }
+        checkInventoryQueries(checker, inventory, reference, region, random, count / 10);
+
+        // Issuing through the string interface follows NextFree
+        const std::string first = RegMark::Mark::FromParts(region, 150000 / 999, 150000 % 999 + 1).Format();
+        const std::string last = RegMark::Mark::FromParts(region, 160000 / 999, 160000 % 999 + 1).Format();
+        std::string previous = first;
+        for (std::size_t i = 0; i < 200; ++i) {
+            const std::optional<RegMark::Mark> expected = inventory.NextFree(*RegMark::Mark::Parse(previous), *RegMark::Mark::Parse(first),
+                                                                             *RegMark::Mark::Parse(last));
+            const std::string issued = inventory.IssueNextMarkAfterRange(previous, first, last);
+            checker.expect(expected ? issued == expected->Format() : issued == RegMark::out_of_stock, "IssueNextMarkAfterRange", previous);
+            if (!expected)
+                break;
+            reference[expected->Position()] = true;
+            previous = issued;
+        }
+        checker.expect(inventory.IssueNextMarkAfterRange("A001AA770", "A001AA780", last) == RegMark::out_of_stock,
+                       "IssueNextMarkAfterRange regions", "");
+
+        // A bitmap issued and released around array_container_limit stays a bitmap until it drops below
+        // array_container_shrink_limit, the snapshot below keeps it a bitmap
+        const std::uint32_t boundary_region = 78;
+        const auto getBoundaryMark = [](std::uint32_t position) { return RegMark::Mark::FromParts(boundary_region, position / 999, position % 999 + 1); };
+        const RegMark::PlateInventory::Stats before_boundary = inventory.GetStats();
+        for (std::uint32_t position = 0; position <= RegMark::PlateInventory::array_container_limit; ++position)
+            checker.expect(inventory.Issue(getBoundaryMark(position)), "PlateInventory::Issue boundary", "");
+        for (std::size_t i = 0; i < 100; ++i) {
+            const RegMark::Mark mark = getBoundaryMark(RegMark::PlateInventory::array_container_limit);
+            checker.expect(inventory.Release(mark) && inventory.Issue(mark), "PlateInventory::Release boundary", "");
+        }
+        for (std::uint32_t position = RegMark::PlateInventory::array_container_limit; position >= RegMark::PlateInventory::array_container_shrink_limit; --position)
+            checker.expect(inventory.Release(getBoundaryMark(position)), "PlateInventory::Release boundary", "");
+        RegMark::PlateInventory::Stats boundary_stats = inventory.GetStats();
+        checker.expect(boundary_stats.bitmap_containers == before_boundary.bitmap_containers + 1
+                           && boundary_stats.array_containers == before_boundary.array_containers,
+                       "PlateInventory bitmap hysteresis", "");
+        checker.expect(inventory.Release(getBoundaryMark(0)) && inventory.Issue(getBoundaryMark(0)), "PlateInventory::Release boundary", "");
+        boundary_stats = inventory.GetStats();
+        checker.expect(boundary_stats.bitmap_containers == before_boundary.bitmap_containers
+                           && boundary_stats.array_containers == before_boundary.array_containers + 1,
+                       "PlateInventory array below the shrink limit", "");
+        checker.expect(inventory.Release(getBoundaryMark(1)), "PlateInventory::Release boundary", "");
+        for (std::uint32_t position = 1; position <= RegMark::PlateInventory::array_container_limit; ++position)
+            checker.expect(inventory.Issue(getBoundaryMark(position)) == (position == 1 || position >= RegMark::PlateInventory::array_container_shrink_limit),
+                           "PlateInventory::Issue boundary", "");
+        checker.expect(inventory.Release(getBoundaryMark(RegMark::PlateInventory::array_container_limit - 1)), "PlateInventory::Release boundary", "");
+        boundary_stats = inventory.GetStats();
+        checker.expect(boundary_stats.bitmap_containers == before_boundary.bitmap_containers + 1, "PlateInventory bitmap hysteresis", "");
+
+        const std::string path = (std::filesystem::temp_directory_path() / ("vin_differential_" + std::to_string(seed) + ".inventory")).string();
+        RegMark::PlateInventory loaded;
+        checker.expect(inventory.Save(path) && loaded.Load(path), "PlateInventory::Save", path);
+        const RegMark::PlateInventory::Stats stats = inventory.GetStats();
+        const RegMark::PlateInventory::Stats loaded_stats = loaded.GetStats();
+        checker.expect(loaded_stats.issued == stats.issued && loaded_stats.regions == stats.regions
+                           && loaded_stats.array_containers == stats.array_containers && loaded_stats.bitmap_containers == stats.bitmap_containers
+                           && stats.bitmap_containers != 0 && stats.array_containers != 0,
+                       "PlateInventory::Load stats", path);
+        checkInventoryQueries(checker, loaded, reference, region, random, count / 10);
+
+        // A truncated snapshot is rejected and the inventory stays as is
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        checker.expect(!loaded.Load(path) && loaded.GetStats().issued == stats.issued, "PlateInventory::Load truncated", path);
+        std::filesystem::remove(path);
+    }
+
+    [[nodiscard]] bool readCorpusFile(const std::string &path, std::vector<std::string> &items)
+    {
+        if (Corpus::readCorpus(path, items))
+            return true;
+        std::cerr << "Error! Can't read " << path << '\n';
+        return false;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t count = 20000;
+    unsigned long long seed = 1;
+    std::vector<std::string> vin_files;
+    std::vector<std::string> mark_files;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--count" && i + 1 < argc)
+            count = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--seed" && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--vins" && i + 1 < argc)
+            vin_files.push_back(argv[++i]);
+        else if (argument == "--marks" && i + 1 < argc)
+            mark_files.push_back(argv[++i]);
+        else {
+            std::cerr << "Usage: vin_differential [--count N] [--seed S] [--vins FILE]... [--marks FILE]...\n";
+            return 2;
+        }
+    }
+
+    // checkVIN and CheckMark print the errors, they are not needed here
+    NullBuffer null_buffer;
+    std::streambuf *error_buffer = std::cerr.rdbuf(&null_buffer);
+
+    Checker checker;
+    Corpus::Generator generator(seed);
+    for (const auto kind : {Corpus::VINKind::VALID, Corpus::VINKind::INVALID_CHECKSUM, Corpus::VINKind::ILLEGAL_SYMBOLS,
+                            Corpus::VINKind::INVALID_SIZE, Corpus::VINKind::RARE_WMI, Corpus::VINKind::MIXED}) {
+        const std::vector<std::string> vins = generator.MakeVINs(kind, count);
+        // The generator itself must produce what was asked
+        for (const auto &vin : vins) {
+            const VIN::VINError error = VIN::validateVIN(vin);
+            if (kind == Corpus::VINKind::VALID || kind == Corpus::VINKind::RARE_WMI)
+                checker.expect(error == VIN::VINError::NONE, "generated valid VIN", vin);
+            else if (kind == Corpus::VINKind::INVALID_CHECKSUM)
+                checker.expect(error == VIN::VINError::INVALID_CHECKSUM, "generated invalid checksum", vin);
+            else if (kind == Corpus::VINKind::INVALID_SIZE)
+                checker.expect(error == VIN::VINError::INVALID_SIZE, "generated invalid size", vin);
+            else if (kind == Corpus::VINKind::ILLEGAL_SYMBOLS)
+                checker.expect(error != VIN::VINError::NONE && error != VIN::VINError::INVALID_SIZE, "generated illegal symbols", vin);
+        }
+        checkVINs(checker, vins);
+    }
+    for (const auto kind : {Corpus::MarkKind::VALID, Corpus::MarkKind::ILLEGAL_SYMBOLS, Corpus::MarkKind::INVALID_REGION,
+                            Corpus::MarkKind::INVALID_SIZE, Corpus::MarkKind::MIXED}) {
+        const std::vector<std::string> marks = generator.MakeMarks(kind, count);
+        for (const auto &mark : marks) {
+            const RegMark::MarkError error = RegMark::ValidateMark(mark);
+            if (kind == Corpus::MarkKind::VALID)
+                checker.expect(error == RegMark::MarkError::NONE, "generated valid mark", mark);
+            else if (kind == Corpus::MarkKind::INVALID_REGION)
+                checker.expect(error == RegMark::MarkError::INVALID_REGION, "generated invalid region", mark);
+            else if (kind != Corpus::MarkKind::MIXED)
+                checker.expect(error != RegMark::MarkError::NONE, "generated invalid mark", mark);
+        }
+        checkMarks(checker, marks);
+    }
+    // Indexes are checked on a corpus with repeated records and many shared prefixes
+    Batch::ThreadPool pool(4);
+    std::vector<std::string> vins = generator.MakeVINs(Corpus::VINKind::MIXED, count);
+    vins.insert(vins.end(), vins.begin(), vins.begin() + count / 10);
+    checkVINIndex(checker, vins, pool);
+    std::vector<std::string> marks = generator.MakeMarks(Corpus::MarkKind::MIXED, count);
+    marks.insert(marks.end(), marks.begin(), marks.begin() + count / 10);
+    checkMarkIndex(checker, marks, pool);
+
+    checkRingBuffers(checker);
+    checkPipeline(checker, vins, Batch::InputKind::VIN);
+    checkPipeline(checker, marks, Batch::InputKind::MARK);
+    checkMetrics(checker);
+
+    // Series and region boundaries, short forms and the legacy region coding
+    checkMarks(checker, {"A999AA770", "A999AY770", "A999YY770", "Y999YY770", "Y999YY050", "X999XX102", "A001AA010",
+                         "A999AA77", "Y999YY05", "A001AA00", "A001AA150", "A001AA7", "A001AA0770",
+                         "A000AA77", "A000AA770", "A000DA77", "A001AA15", "A001AA015", "A001AA19", "A001AA190", "A001AA750"});
+    checkPlates(checker, seed, count);
+    checkPlateInventory(checker, seed, count);
+
+    std::vector<std::string> items;
+    for (const auto &path : vin_files) {
+        if (!readCorpusFile(path, items))
+            return 1;
+        checkVINs(checker, items);
+    }
+    for (const auto &path : mark_files) {
+        if (!readCorpusFile(path, items))
+            return 1;
+        checkMarks(checker, items);
+    }
+
+    std::cerr.rdbuf(error_buffer);
+    std::cout << checker.getChecks() << " checks, " << checker.getMismatches() << " mismatches\n";
+    return checker.getMismatches() == 0 ? 0 : 1;
+}
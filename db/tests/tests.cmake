@@ -0,0 +1,2 @@
+set(differential_source
+    tests/differential.cpp)
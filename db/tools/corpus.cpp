@@ -0,0 +1,181 @@
+//Randomized corpora of VIN numbers and russian vehicle marks for benchmarks and differential tests
+#include "corpus.hpp"
+#include <array>
+#include <fstream>
+#include "reg_mark.hpp"
+#include "vin.hpp"
+
+using string = std::string;
+using size_t = std::size_t;
+using uint32_t = std::uint32_t;
+
+namespace Corpus {
+    const size_t vin_size = 17;
+    const std::string_view vin_symbols = "0123456789ABCDEFGHJKLMNPRSTUVWXYZ";
+    const std::string_view illegal_vin_symbols = "IOQiaz -_*\t\x80";
+    const std::string_view illegal_mark_letters = "DFGIJLNQRSUVWZabx -";
+    // WMI of popular manufacturers
+    const std::array<std::string_view, 12> common_wmi = {"1HG", "1FT", "2T1", "3VW", "JTD", "KMH",
+                                                         "WVW", "WBA", "VF1", "XTA", "Z94", "SAL"};
+    // First two symbols at the edges of the country ranges and in the digit ranges
+    const std::array<std::string_view, 16> rare_wmi_prefixes = {"K0", "KS", "L0", "LA", "S1", "S4", "S5", "TP",
+                                                                "X0", "Z0", "30", "3X", "80", "90", "99", "Y6"};
+    // Regions that end with 0 are read as two-digit ones, so they are not used here
+    const std::array<uint32_t, 3> invalid_three_digit_regions = {555, 201, 998};
+}
+
+[[nodiscard]] string Corpus::Generator::makeValidVIN(std::string_view wmi)
+{
+    string vin(wmi);
+    while (vin.size() < vin_size)
+        vin += vin_symbols[below(vin_symbols.size())];
+    vin[8] = VIN::getCheckDigit(vin);
+    return vin;
+}
+
+[[nodiscard]] string Corpus::Generator::MakeVIN(VINKind kind)
+{
+    if (kind == VINKind::MIXED)
+        kind = static_cast<VINKind>(below(static_cast<int>(VINKind::MIXED)));
+    switch (kind) {
+    case VINKind::INVALID_CHECKSUM: {
+        string vin = makeValidVIN(common_wmi[below(common_wmi.size())]);
+        const char check_digit = vin[8];
+        while (vin[8] == check_digit)
+            vin[8] = "0123456789X"[below(11)];
+        return vin;
+    }
+    case VINKind::ILLEGAL_SYMBOLS: {
+        string vin = makeValidVIN(common_wmi[below(common_wmi.size())]);
+        vin[below(vin_size)] = illegal_vin_symbols[below(illegal_vin_symbols.size())];
+        return vin;
+    }
+    case VINKind::INVALID_SIZE: {
+        size_t size = below(2 * vin_size);
+        if (size == vin_size)
+            ++size;
+        string vin = makeValidVIN(common_wmi[below(common_wmi.size())]);
+        vin.resize(size, vin_symbols[below(vin_symbols.size())]);
+        return vin;
+    }
+    case VINKind::RARE_WMI: {
+        string wmi(rare_wmi_prefixes[below(rare_wmi_prefixes.size())]);
+        wmi += vin_symbols[below(vin_symbols.size())];
+        return makeValidVIN(wmi);
+    }
+    default:
+        return makeValidVIN(common_wmi[below(common_wmi.size())]);
+    }
+}
+
+[[nodiscard]] string Corpus::Generator::MakeMark(MarkKind kind)
+{
+    if (kind == MarkKind::MIXED)
+        kind = static_cast<MarkKind>(below(static_cast<int>(MarkKind::MIXED)));
+    uint32_t region = 1 + below(99);
+    if (below(4) == 0)
+        region = RegMark::unique_region_codes[below(RegMark::max_unique_codes)];
+    const uint32_t series = below(RegMark::Mark::series_count);
+    const uint32_t number = 1 + below(RegMark::Mark::max_number);
+    string mark = RegMark::Mark::FromParts(region, series, number).Format();
+    switch (kind) {
+    case MarkKind::VALID:
+        // Some of the two digit regions are written in the short a999aa99 form
+        if (region < 100 && below(4) == 0)
+            mark.replace(6, 3, string{static_cast<char>('0' + region / 10), static_cast<char>('0' + region % 10)});
+        return mark;
+    case MarkKind::ILLEGAL_SYMBOLS: {
+        const std::array<size_t, 3> letter_positions = {0, 4, 5};
+        mark[letter_positions[below(letter_positions.size())]] = illegal_mark_letters[below(illegal_mark_letters.size())];
+        return mark;
+    }
+    case MarkKind::INVALID_REGION: {
+        if (below(2) == 0) {
+            mark.replace(6, 3, "000");
+        } else {
+            const uint32_t invalid_region = invalid_three_digit_regions[below(invalid_three_digit_regions.size())];
+            mark.replace(6, 3, std::to_string(invalid_region));
+        }
+        return mark;
+    }
+    case MarkKind::INVALID_SIZE:
+        mark.resize(below(2) == 0 ? 6 + below(2) : 10 + below(3), '7');
+        return mark;
+    default:
+        return mark;
+    }
+}
+
+[[nodiscard]] std::vector<string> Corpus::Generator::MakeVINs(VINKind kind, size_t count)
+{
+    std::vector<string> items;
+    items.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        items.push_back(MakeVIN(kind));
+    return items;
+}
+
+[[nodiscard]] std::vector<string> Corpus::Generator::MakeMarks(MarkKind kind, size_t count)
+{
+    std::vector<string> items;
+    items.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        items.push_back(MakeMark(kind));
+    return items;
+}
+
+[[nodiscard]] bool Corpus::parseVINKind(std::string_view name, VINKind &kind) noexcept
+{
+    if (name == "valid")
+        kind = VINKind::VALID;
+    else if (name == "invalid_checksum")
+        kind = VINKind::INVALID_CHECKSUM;
+    else if (name == "illegal_symbols")
+        kind = VINKind::ILLEGAL_SYMBOLS;
+    else if (name == "invalid_size")
+        kind = VINKind::INVALID_SIZE;
+    else if (name == "rare_wmi")
+        kind = VINKind::RARE_WMI;
+    else if (name == "mixed")
+        kind = VINKind::MIXED;
+    else
+        return false;
+    return true;
+}
+
+[[nodiscard]] bool Corpus::parseMarkKind(std::string_view name, MarkKind &kind) noexcept
+{
+    if (name == "valid")
+        kind = MarkKind::VALID;
+    else if (name == "illegal_symbols")
+        kind = MarkKind::ILLEGAL_SYMBOLS;
+    else if (name == "invalid_region")
+        kind = MarkKind::INVALID_REGION;
+    else if (name == "invalid_size")
+        kind = MarkKind::INVALID_SIZE;
+    else if (name == "mixed")
+        kind = MarkKind::MIXED;
+    else
+        return false;
+    return true;
+}
+
+[[nodiscard]] bool Corpus::writeCorpus(const string &path, const std::vector<string> &items)
+{
+    std::ofstream file(path, std::ios::binary);
+    for (const auto &item : items)
+        file << item << '\n';
+    return static_cast<bool>(file);
+}
+
+[[nodiscard]] bool Corpus::readCorpus(const string &path, std::vector<string> &items)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    items.clear();
+    string line;
+    while (std::getline(file, line))
+        items.push_back(line);
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Corpus {
+    enum class VINKind {
+        VALID,
+        INVALID_CHECKSUM,
+        ILLEGAL_SYMBOLS,
+        INVALID_SIZE,
+        RARE_WMI,   // Valid VIN numbers with WMI from the edges of the country ranges
+        MIXED       // Any of the kinds above
+    };
+    enum class MarkKind {
+        VALID,
+        ILLEGAL_SYMBOLS,
+        INVALID_REGION,
+        INVALID_SIZE,
+        MIXED
+    };
+
+    //  Reproducible generator of VIN numbers and license plate numbers: the same seed gives the same
+    //  corpus on every platform. Valid VIN numbers get the check digit from VIN::getCheckDigit,
+    //  valid marks use only legal series letters and existing regions.
+    class Generator {
+    public:
+        explicit Generator(std::uint64_t seed) : random(seed) {}
+
+        [[nodiscard]] std::string MakeVIN(VINKind kind);
+        [[nodiscard]] std::string MakeMark(MarkKind kind);
+        [[nodiscard]] std::vector<std::string> MakeVINs(VINKind kind, std::size_t count);
+        [[nodiscard]] std::vector<std::string> MakeMarks(MarkKind kind, std::size_t count);
+    private:
+        // Distributions of the standard library differ between implementations, so they are not used
+        [[nodiscard]] std::uint64_t below(std::uint64_t bound) { return random() % bound; }
+        [[nodiscard]] std::string makeValidVIN(std::string_view wmi);
+
+        std::mt19937_64 random;
+    };
+
+    //  Names used by the corpus tool: valid, invalid_checksum, illegal_symbols, invalid_size, rare_wmi,
+    //  invalid_region, mixed. Return false for unknown names
+    [[nodiscard]] bool parseVINKind(std::string_view name, VINKind &kind) noexcept;
+    [[nodiscard]] bool parseMarkKind(std::string_view name, MarkKind &kind) noexcept;
+
+    //  Corpus file is one item per line
+    [[nodiscard]] bool writeCorpus(const std::string &path, const std::vector<std::string> &items);
+    [[nodiscard]] bool readCorpus(const std::string &path, std::vector<std::string> &items);
+}
@@ -0,0 +1,6 @@
+set(corpus_source
+    tools/corpus.cpp)
+set(vin_corpus_source
+    tools/vin_corpus.cpp)
+set(vin_registry_source
+    tools/vin_registry.cpp)
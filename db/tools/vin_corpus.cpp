@@ -0,0 +1,66 @@
+//Writes a reproducible corpus of VIN numbers or license plate numbers, one per line
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "corpus.hpp"
+
+const char *usage =
+    "Usage: vin_corpus [--marks] [--kind KIND] [--count N] [--seed S] [FILE]\n"
+    "Writes N generated VIN numbers (or license plate numbers with --marks) to FILE or standard output.\n"
+    "VIN kinds:  valid, invalid_checksum, illegal_symbols, invalid_size, rare_wmi, mixed\n"
+    "Mark kinds: valid, illegal_symbols, invalid_region, invalid_size, mixed\n";
+
+int main(int argc, char *argv[])
+{
+    bool marks = false;
+    std::string kind_name = "valid";
+    unsigned long long count = 1000000;
+    unsigned long long seed = 1;
+    std::string output_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--marks") {
+            marks = true;
+        } else if (argument == "--kind" && i + 1 < argc) {
+            kind_name = argv[++i];
+        } else if (argument == "--count" && i + 1 < argc) {
+            count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argument == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (output_path.empty() && argument[0] != '-') {
+            output_path = argument;
+        } else {
+            std::cerr << usage;
+            return 2;
+        }
+    }
+
+    Corpus::Generator generator(seed);
+    std::vector<std::string> items;
+    if (marks) {
+        Corpus::MarkKind kind;
+        if (!Corpus::parseMarkKind(kind_name, kind)) {
+            std::cerr << usage;
+            return 2;
+        }
+        items = generator.MakeMarks(kind, count);
+    } else {
+        Corpus::VINKind kind;
+        if (!Corpus::parseVINKind(kind_name, kind)) {
+            std::cerr << usage;
+            return 2;
+        }
+        items = generator.MakeVINs(kind, count);
+    }
+
+    if (output_path.empty()) {
+        for (const auto &item : items)
+            std::cout << item << '\n';
+        return std::cout ? 0 : 1;
+    }
+    if (!Corpus::writeCorpus(output_path, items)) {
+        std::cerr << "Error! Can't write " << output_path << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+//Builds a columnar registry from a text file and queries it through the memory-mapped reader
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "index.hpp"
+#include "registry.hpp"
+#include "stream_processor.hpp"
+
+const char *usage =
+    "Usage: vin_registry build [--marks] INPUT REGISTRY\n"
+    "       vin_registry dump REGISTRY [FIRST [COUNT]]\n"
+    "       vin_registry stats REGISTRY\n"
+    "       vin_registry find REGISTRY PREFIX [YEAR]\n"
+    "       vin_registry range REGISTRY FIRST_MARK LAST_MARK\n"
+    "build reads one VIN number (or license plate number with --marks) per line.\n"
+    "find prints the VIN numbers that start with PREFIX (and have the model YEAR),\n"
+    "range prints the marks from FIRST_MARK to LAST_MARK.\n";
+
+int build(const std::string &input_path, const std::string &registry_path, Registry::RecordKind kind)
+{
+    std::ifstream input(input_path);
+    if (!input) {
+        std::cerr << "Error! Can't read " << input_path << '\n';
+        return 1;
+    }
+    Registry::Writer writer(registry_path, kind);
+    if (!writer.IsOpen()) {
+        std::cerr << "Error! Can't write " << registry_path << '\n';
+        return 1;
+    }
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (kind == Registry::RecordKind::VIN)
+            writer.AddVIN(line);
+        else
+            writer.AddMark(line);
+    }
+    const std::uint64_t rows = writer.Size();
+    if (!writer.Close()) {
+        std::cerr << "Error! Can't write " << registry_path << '\n';
+        return 1;
+    }
+    std::cout << rows << " records\n";
+    return 0;
+}
+
+void printRow(const Registry::Reader &reader, std::uint64_t row)
+{
+    if (reader.Kind() == Registry::RecordKind::VIN) {
+        std::cout << reader.VINAt(row) << ',' << (reader.ValidAt(row) ? 1 : 0) << ','
+                  << Batch::getErrorCodeName(Batch::InputKind::VIN, reader.ErrorAt(row)) << ','
+                  << VIN::getCountryName(reader.CountryAt(row)) << ',' << reader.ModelYearAt(row) << '\n';
+    } else {
+        const std::string mark = reader.ValidAt(row) ? reader.MarkAt(row).Format() : std::string();
+        std::cout << mark << ',' << (reader.ValidAt(row) ? 1 : 0) << ','
+                  << Batch::getErrorCodeName(Batch::InputKind::MARK, reader.ErrorAt(row)) << '\n';
+    }
+}
+
+int dump(const Registry::Reader &reader, std::uint64_t first, std::uint64_t count)
+{
+    const std::uint64_t last = first + count < reader.Size() && first + count >= first ? first + count : reader.Size();
+    for (std::uint64_t row = first; row < last; ++row)
+        printRow(reader, row);
+    return std::cout ? 0 : 1;
+}
+
+// The index is built on all cores for every query, it's not stored
+int find(const Registry::Reader &reader, const std::string &prefix, const char *year)
+{
+    if (reader.Kind() != Registry::RecordKind::VIN) {
+        std::cerr << "Error! find needs a VIN registry\n";
+        return 1;
+    }
+    Batch::ThreadPool pool;
+    const Index::VINIndex index = Index::VINIndex::Build(reader, pool);
+    if (year != nullptr) {
+        const auto model_year = static_cast<std::uint16_t>(std::strtoul(year, nullptr, 10));
+        for (const std::uint64_t row : index.FindByWMIAndYear(prefix.substr(0, 3), model_year)) {
+            if (reader.VINAt(row).compare(0, prefix.size(), prefix) == 0)
+                printRow(reader, row);
+        }
+    } else {
+        for (const auto &entry : index.FindPrefix(prefix))
+            printRow(reader, entry.row);
+    }
+    return std::cout ? 0 : 1;
+}
+
+int range(const Registry::Reader &reader, const std::string &first, const std::string &last)
+{
+    if (reader.Kind() != Registry::RecordKind::MARK) {
+        std::cerr << "Error! range needs a mark registry\n";
+        return 1;
+    }
+    const std::optional<RegMark::Mark> first_mark = RegMark::Mark::Parse(first);
+    const std::optional<RegMark::Mark> last_mark = RegMark::Mark::Parse(last);
+    if (!first_mark || !last_mark) {
+        std::cerr << "Error! Invalid mark\n";
+        return 1;
+    }
+    Batch::ThreadPool pool;
+    const Index::MarkIndex index = Index::MarkIndex::Build(reader, pool);
+    for (const auto &entry : index.FindRange(*first_mark, *last_mark))
+        printRow(reader, entry.row);
+    return std::cout ? 0 : 1;
+}
+
+// Scans the error column group by group
+int stats(const Registry::Reader &reader)
+{
+    std::uint64_t valid = 0;
+    for (std::size_t i = 0; i < reader.GroupCount(); ++i) {
+        const Registry::ColumnGroup group = reader.Group(i);
+        for (std::size_t row = 0; row < group.rows; ++row)
+            valid += group.errors[row] == 0;
+    }
+    std::cout << (reader.Kind() == Registry::RecordKind::VIN ? "VIN" : "mark") << " registry: "
+              << reader.Size() << " records, " << valid << " valid, "
+              << reader.GroupCount() << " row groups\n";
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string command = argc > 1 ? argv[1] : "";
+    if (command == "build") {
+        const bool marks = argc == 5 && std::string(argv[2]) == "--marks";
+        if (argc != 4 && !marks) {
+            std::cerr << usage;
+            return 2;
+        }
+        return build(argv[argc - 2], argv[argc - 1], marks ? Registry::RecordKind::MARK : Registry::RecordKind::VIN);
+    }
+    const bool known = (command == "dump" && argc >= 3 && argc <= 5) || (command == "stats" && argc == 3)
+                    || (command == "find" && (argc == 4 || argc == 5)) || (command == "range" && argc == 5);
+    if (!known) {
+        std::cerr << usage;
+        return 2;
+    }
+
+    const Registry::Reader reader(argv[2]);
+    if (!reader.IsOpen()) {
+        std::cerr << "Error! " << argv[2] << " is not a registry\n";
+        return 1;
+    }
+    if (command == "stats")
+        return stats(reader);
+    if (command == "find")
+        return find(reader, argv[3], argc > 4 ? argv[4] : nullptr);
+    if (command == "range")
+        return range(reader, argv[3], argv[4]);
+    const std::uint64_t first = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0;
+    const std::uint64_t count = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : reader.Size();
+    return dump(reader, first, count);
+}